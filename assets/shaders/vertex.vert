@@ -13,10 +13,28 @@ uniform mat4 projection;
 
 uniform float texScale = 1;
 
+// compact vertex layouts: unorm attributes span these ranges, normals may
+// be octahedral in aNormal.xy. the defaults leave float vertices as they are
+uniform vec3 positionOffset = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
+uniform vec2 uvOffset = vec2(0.0);
+uniform vec2 uvScale = vec2(1.0);
+uniform bool octNormals = false;
+
+vec3 DecodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    TexCoords = aTexCoords * texScale;
+    vec3 position = positionOffset + aPos * positionScale;
+    vec3 normal = octNormals ? DecodeOctahedral(aNormal.xy) : aNormal;
+
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    TexCoords = (uvOffset + aTexCoords * uvScale) * texScale;
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
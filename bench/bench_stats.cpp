@@ -0,0 +1,186 @@
+#include "bench_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+    std::atomic<uint64_t> allocationCount{ 0 };
+    std::atomic<uint64_t> allocationBytes{ 0 };
+
+    void* Allocate(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+        return std::malloc(size ? size : 1);
+    }
+}
+
+// every heap allocation of the bench goes through these, loader code included
+void* operator new(size_t size)
+{
+    void* p = Allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    void* p = Allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+AllocationStats CurrentAllocations()
+{
+    AllocationStats stats;
+    stats.count = allocationCount.load(std::memory_order_relaxed);
+    stats.bytes = allocationBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t PeakRssBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+double Percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty()) return 0.0;
+    std::sort(samples.begin(), samples.end());
+    const double rank = std::ceil(p / 100.0 * static_cast<double>(samples.size()));
+    const size_t index = static_cast<size_t>(std::min(std::max(rank, 1.0), static_cast<double>(samples.size())));
+    return samples[index - 1];
+}
+
+void JsonWriter::Member(const char* key)
+{
+    if (!first.empty()) {
+        if (!first.back()) text += ',';
+        first.back() = false;
+        text += '\n';
+        text.append(first.size() * 2, ' ');
+    }
+    if (key) {
+        text += '"';
+        text += key;
+        text += "\": ";
+    }
+}
+
+void JsonWriter::BeginObject(const char* key)
+{
+    Member(key);
+    text += '{';
+    first.push_back(true);
+}
+
+void JsonWriter::EndObject()
+{
+    const bool empty = first.back();
+    first.pop_back();
+    if (!empty) {
+        text += '\n';
+        text.append(first.size() * 2, ' ');
+    }
+    text += '}';
+    if (first.empty()) text += '\n';
+}
+
+void JsonWriter::BeginArray(const char* key)
+{
+    Member(key);
+    text += '[';
+    first.push_back(true);
+}
+
+void JsonWriter::EndArray()
+{
+    const bool empty = first.back();
+    first.pop_back();
+    if (!empty) {
+        text += '\n';
+        text.append(first.size() * 2, ' ');
+    }
+    text += ']';
+}
+
+void JsonWriter::Value(const char* key, const std::string& value)
+{
+    Member(key);
+    text += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            text += '\\';
+            text += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+            text += escaped;
+        }
+        else {
+            text += c;
+        }
+    }
+    text += '"';
+}
+
+void JsonWriter::Value(const char* key, double value)
+{
+    Member(key);
+    if (!std::isfinite(value)) {
+        text += "null";
+        return;
+    }
+    char number[32];
+    std::snprintf(number, sizeof(number), "%.6g", value);
+    text += number;
+}
+
+void JsonWriter::Value(const char* key, uint64_t value)
+{
+    Member(key);
+    text += std::to_string(value);
+}
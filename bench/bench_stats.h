@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// measurement helpers for loader_bench: heap allocation counters fed by the
+// bench's replacement operator new, process peak memory, percentiles over
+// repeated runs and a small json writer for the report.
+
+// operator new calls and bytes requested since the process started
+struct AllocationStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+AllocationStats CurrentAllocations();
+
+// peak resident set (peak working set on windows) of the process in bytes,
+// 0 where the platform does not report it
+uint64_t PeakRssBytes();
+
+// nearest-rank percentile, p in [0, 100], of unsorted samples. 0 when empty
+double Percentile(std::vector<double> samples, double p);
+
+// streaming json output with just what the report needs: objects, arrays,
+// strings and numbers, indented two spaces
+class JsonWriter {
+public:
+    void BeginObject(const char* key = nullptr);
+    void EndObject();
+    void BeginArray(const char* key = nullptr);
+    void EndArray();
+
+    void Value(const char* key, const std::string& value);
+    void Value(const char* key, double value);
+    void Value(const char* key, uint64_t value);
+
+    const std::string& Text() const { return text; }
+
+private:
+    // comma, newline and indent before the next member, then its key
+    void Member(const char* key);
+
+    std::string text;
+    std::vector<bool> first;    // per open scope, whether nothing was written yet
+};
@@ -0,0 +1,932 @@
+// headless loader benchmark: parses obj files with each ParseMode and thread
+// count and reports throughput, checking that every run produces the same mesh.
+// --cache also compares the raw and packed cache encodings, --optimize
+// times the mesh optimizer passes and reports their simulated effect, --lods
+// builds a level-of-detail chain and reports each level's size and error.
+// --suite replaces the parse table with the regression suite: cold, warm and
+// cached loads plus every mesh pass, as percentiles over the runs with
+// throughput, allocations (also per MB of obj) and peak memory, written as
+// json with --json.
+// files with an obj_generator checksum next to them are checked against it.
+// --trace records profiler zones for the whole run as a chrome trace.
+// --codecs round trips fixed texture blocks through every bc encoder
+// --parse-cases loads hand-written objs, checking the exact mesh each gives
+#include "bench_stats.h"
+#include "mesh_checksum.h"
+#include "../include/cache_store.h"
+#include "../include/loader.h"
+#include "../include/log.h"
+#include "../include/mesh_cache.h"
+#include "../include/mesh_optimizer.h"
+#include "../include/mesh_simplifier.h"
+#include "../include/meshlet_builder.h"
+#include "../include/number_parse.h"
+#include "../include/profiler.h"
+#include "../include/texture_codec.h"
+#include "../include/thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct RunResult {
+        double bestMs = 0.0;
+        double meanMs = 0.0;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+
+    // one row of the report
+    struct Config {
+        std::string label;
+        ParseMode mode;
+        unsigned int threads;
+    };
+
+    RunResult Run(const std::string& path, const Config& config, int runs)
+    {
+        RunResult result;
+        double total = 0.0;
+        result.bestMs = 1e30;
+
+        for (int r = 0; r < runs; ++r) {
+            Loader loader;
+            loader.parseMode = config.mode;
+            loader.threadCount = config.threads;
+            loader.useCache = false;
+
+            auto start = std::chrono::steady_clock::now();
+            loader.GetVertices(path);
+            auto stop = std::chrono::steady_clock::now();
+
+            double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+            total += ms;
+            result.bestMs = std::min(result.bestMs, ms);
+
+            if (r == runs - 1) {
+                result.vertices = std::move(loader.vertices);
+                result.indices = std::move(loader.indices);
+            }
+        }
+        result.meanMs = total / runs;
+        return result;
+    }
+
+    template <typename F>
+    double TimeMs(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count();
+    }
+
+    // float parse phase in isolation: stringstream vs ParseFloat on obj-style text
+    int BenchNumbers(int count)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+        const char* formats[] = { "%f", "%.9g", "%e" };
+
+        std::string text;
+        char buffer[64];
+        for (int i = 0; i < count; ++i) {
+            std::snprintf(buffer, sizeof(buffer), formats[i % 3], dist(rng));
+            text += buffer;
+            text += ' ';
+        }
+
+        std::vector<float> fromStream(count), fromFast(count);
+        double streamMs = TimeMs([&]() {
+            std::stringstream ss(text);
+            for (int i = 0; i < count; ++i) ss >> fromStream[i];
+        });
+        double fastMs = TimeMs([&]() {
+            const char* p = text.data();
+            const char* end = p + text.size();
+            for (int i = 0; i < count; ++i) {
+                p = ParseFloat(p, end, fromFast[i]).ptr + 1;
+            }
+        });
+
+        double mb = static_cast<double>(text.size()) / (1024.0 * 1024.0);
+        std::cout << "numbers (" << count << " floats, " << std::fixed << std::setprecision(2) << mb << " MB)\n"
+            << "  stringstream " << std::setw(9) << streamMs << " ms  " << std::setw(8) << mb / (streamMs / 1000.0) << " MB/s\n"
+            << "  ParseFloat   " << std::setw(9) << fastMs << " ms  " << std::setw(8) << mb / (fastMs / 1000.0) << " MB/s"
+            << "  (" << streamMs / fastMs << "x)\n";
+
+        if (std::memcmp(fromStream.data(), fromFast.data(), count * sizeof(float)) != 0) {
+            std::cerr << "  mismatch: ParseFloat differs from stringstream\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // bits read lsb first from a 128-bit block
+    uint32_t GetBits(const unsigned char* block, int& position, int bits)
+    {
+        uint32_t value = 0;
+        for (int b = 0; b < bits; ++b, ++position) {
+            value |= static_cast<uint32_t>((block[position >> 3] >> (position & 7)) & 1) << b;
+        }
+        return value;
+    }
+
+    void DecodeBc1Colour(const unsigned char* block, unsigned char out[64])
+    {
+        const uint16_t packed[2] = { static_cast<uint16_t>(block[0] | (block[1] << 8)),
+            static_cast<uint16_t>(block[2] | (block[3] << 8)) };
+        int palette[4][3];
+        for (int e = 0; e < 2; ++e) {
+            const int r = (packed[e] >> 11) & 31, g = (packed[e] >> 5) & 63, b = packed[e] & 31;
+            palette[e][0] = (r << 3) | (r >> 2);
+            palette[e][1] = (g << 2) | (g >> 4);
+            palette[e][2] = (b << 3) | (b >> 2);
+        }
+        for (int c = 0; c < 3; ++c) {
+            if (packed[0] > packed[1]) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+            else {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 3; ++c) out[i * 4 + c] = static_cast<unsigned char>(palette[(indices >> (i * 2)) & 3][c]);
+        }
+    }
+
+    void DecodeBc3Alpha(const unsigned char* block, unsigned char out[64])
+    {
+        int palette[8] = { block[0], block[1] };
+        for (int p = 2; p < 8; ++p) {
+            palette[p] = block[0] > block[1] ? ((8 - p) * block[0] + (p - 1) * block[1] + 3) / 7
+                : (p < 6 ? ((6 - p) * block[0] + (p - 1) * block[1] + 2) / 5 : (p == 6 ? 0 : 255));
+        }
+        uint64_t indices = 0;
+        for (int b = 0; b < 6; ++b) indices |= static_cast<uint64_t>(block[2 + b]) << (b * 8);
+        for (int i = 0; i < 16; ++i) out[i * 4 + 3] = static_cast<unsigned char>(palette[(indices >> (i * 3)) & 7]);
+    }
+
+    // mode 6 only, the one the encoder writes
+    bool DecodeBc7(const unsigned char* block, unsigned char out[64])
+    {
+        static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        int position = 0;
+        if (GetBits(block, position, 7) != (1u << 6)) return false;
+        int endpoints[2][4];
+        for (int c = 0; c < 4; ++c) {
+            for (int e = 0; e < 2; ++e) endpoints[e][c] = static_cast<int>(GetBits(block, position, 7)) << 1;
+        }
+        for (int e = 0; e < 2; ++e) {
+            const int bit = static_cast<int>(GetBits(block, position, 1));
+            for (int c = 0; c < 4; ++c) endpoints[e][c] |= bit;
+        }
+        for (int i = 0; i < 16; ++i) {
+            const int w = weights[GetBits(block, position, i == 0 ? 3 : 4)];
+            for (int c = 0; c < 4; ++c) {
+                out[i * 4 + c] = static_cast<unsigned char>(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+            }
+        }
+        return true;
+    }
+
+    // encodes single blocks whose colours the decoded block must keep, such
+    // as a red/green checker whose main axis is at right angles to gray
+    int CheckCodecs()
+    {
+        struct Case {
+            const char* name;
+            unsigned char colours[2][4];
+        };
+        const Case cases[] = {
+            { "red/green", { { 255, 0, 0, 255 }, { 0, 255, 0, 255 } } },
+            { "blue/yellow", { { 0, 0, 255, 255 }, { 255, 255, 0, 255 } } },
+            { "black/white", { { 0, 0, 0, 255 }, { 255, 255, 255, 255 } } },
+        };
+        const TextureFormat formats[] = { TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC7 };
+        const char* formatNames[] = { "bc1", "bc3", "bc7" };
+        // bc1 endpoints are 565 and bc7's 7 bits plus a p-bit
+        constexpr int kTolerance = 8;
+
+        int failures = 0;
+        std::cout << "codecs\n";
+        for (const Case& test : cases) {
+            MipLevel level;
+            level.width = 4;
+            level.height = 4;
+            level.pixels.resize(64);
+            for (int i = 0; i < 16; ++i) std::memcpy(&level.pixels[i * 4], test.colours[((i & 3) + (i >> 2)) & 1], 4);
+
+            for (size_t f = 0; f < 3; ++f) {
+                const MipLevel encoded = EncodeLevel(level, formats[f]);
+                unsigned char decoded[64];
+                std::memset(decoded, 255, sizeof(decoded));
+                bool ok = encoded.pixels.size() == BlockBytes(formats[f]);
+                if (ok && formats[f] == TextureFormat::BC1) DecodeBc1Colour(encoded.pixels.data(), decoded);
+                if (ok && formats[f] == TextureFormat::BC3) {
+                    DecodeBc3Alpha(encoded.pixels.data(), decoded);
+                    DecodeBc1Colour(encoded.pixels.data() + 8, decoded);
+                }
+                if (ok && formats[f] == TextureFormat::BC7) ok = DecodeBc7(encoded.pixels.data(), decoded);
+
+                int worst = 0;
+                for (int i = 0; ok && i < 64; ++i) worst = std::max(worst, std::abs(decoded[i] - level.pixels[i]));
+                ok = ok && worst <= kTolerance;
+                std::cout << "  " << std::left << std::setw(12) << test.name << std::right << formatNames[f]
+                    << (ok ? "  ok" : "  FAILED") << "  max error " << worst << "\n";
+                if (!ok) ++failures;
+            }
+        }
+        return failures;
+    }
+
+    // pad text with comment lines, and a blank one if need be, to size bytes
+    std::string PadObj(std::string text, size_t size)
+    {
+        while (text.size() < size) {
+            std::string line(std::min<size_t>(80, size - text.size()), ' ');
+            line.front() = '#';
+            line.back() = '\n';
+            text += line;
+        }
+        return text;
+    }
+
+    // hand-written objs with the mesh they must parse to, in every mode. the
+    // chunk case is padded so two threads split it right before its faces
+    int CheckParseCases()
+    {
+        struct Case {
+            const char* name;
+            std::string obj;
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            size_t errors;
+        };
+        const glm::vec3 p1(1.0f, 0.0f, 0.0f), p2(0.0f, 1.0f, 0.0f), p3(0.0f, 0.0f, 1.0f), p4(1.0f, 1.0f, 0.0f);
+        const glm::vec2 t1(0.25f, 0.5f), t2(0.75f, 1.0f);
+        const glm::vec3 n1(0.0f, 0.0f, 1.0f), zero(0.0f);
+        const std::string triangle = "v 1 0 0\nv 0 1 0\nv 0 0 1\n";
+
+        // two chunks of 1.25 MiB, the byte in the middle ends the first
+        constexpr size_t kChunkedBytes = 5 << 19;
+        const std::string chunked =
+            PadObj(triangle + "vn 0 0 1\n", kChunkedBytes / 2 + 1) +
+            PadObj("f -3//-1 -2//-1 -1//-1\nv 1 1 0\nf -3 -1 -2\n", kChunkedBytes - kChunkedBytes / 2 - 1);
+
+        const Case cases[] = {
+            { "relative vt", triangle + "vt 0.25 0.5\nvt 0.75 1\nf 1/-2 2/-1 3/-1\n",
+                { { p1, t1, zero }, { p2, t2, zero }, { p3, t2, zero } }, { 0, 1, 2 }, 0 },
+            { "relative vn", triangle + "vn 0 0 1\nf 1//-1 2//-1 3//-1\n",
+                { { p1, glm::vec2(0.0f), n1 }, { p2, glm::vec2(0.0f), n1 }, { p3, glm::vec2(0.0f), n1 } }, { 0, 1, 2 }, 0 },
+            { "relative v", triangle + "f -3 -2 -1\nv 1 1 0\nf -3 -2 -1\n",
+                { { p1, glm::vec2(0.0f), zero }, { p2, glm::vec2(0.0f), zero }, { p3, glm::vec2(0.0f), zero }, { p4, glm::vec2(0.0f), zero } },
+                { 0, 1, 2, 1, 2, 3 }, 0 },
+            // past the first attribute reads as missing, like a too large absolute index
+            { "out of range", triangle + "vt 0.25 0.5\nf -4/-1 -2/-2 -1/-1\n",
+                { { zero, t1, zero }, { p2, glm::vec2(0.0f), zero }, { p3, t1, zero } }, { 0, 1, 2 }, 0 },
+            { "index 0", triangle + "f 0 2 3\nf 1/0 2 3\n",
+                { { zero, glm::vec2(0.0f), zero }, { p2, glm::vec2(0.0f), zero }, { p3, glm::vec2(0.0f), zero }, { p1, glm::vec2(0.0f), zero } },
+                { 0, 1, 2, 3, 1, 2 }, 2 },
+            { "chunk start", chunked,
+                { { p1, glm::vec2(0.0f), n1 }, { p2, glm::vec2(0.0f), n1 }, { p3, glm::vec2(0.0f), n1 },
+                  { p2, glm::vec2(0.0f), zero }, { p4, glm::vec2(0.0f), zero }, { p3, glm::vec2(0.0f), zero } },
+                { 0, 1, 2, 3, 4, 5 }, 0 },
+        };
+        const Config configs[] = {
+            { "stream", ParseMode::Stream, 1 },
+            { "mapped", ParseMode::Mapped, 1 },
+            { "chunked", ParseMode::Mapped, 2 },
+        };
+
+        const fs::path path = fs::temp_directory_path() / "loader_bench.case.obj";
+        int failures = 0;
+        std::cout << "parse cases\n";
+        for (const Case& test : cases) {
+            {
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                out << test.obj;
+            }
+            for (const Config& config : configs) {
+                Loader loader;
+                loader.parseMode = config.mode;
+                loader.threadCount = config.threads;
+                loader.useCache = false;
+                loader.GetVertices(path.string());
+
+                const bool ok = loader.vertices == test.vertices && loader.indices == test.indices &&
+                    loader.parseErrors == test.errors;
+                std::cout << "  " << std::left << std::setw(14) << test.name << std::setw(9) << config.label << std::right
+                    << (ok ? "ok" : "FAILED") << "  " << loader.vertices.size() << " vertices, "
+                    << loader.indices.size() << " indices, " << loader.parseErrors << " errors\n";
+                if (!ok) ++failures;
+            }
+        }
+        std::error_code ec;
+        fs::remove(path, ec);
+        return failures;
+    }
+
+    // size, encode and decode time of each cache encoding for a parsed mesh,
+    // with float and compact vertices, and 16-bit indices when the mesh is
+    // small enough. sizes are relative to raw floats
+    int BenchCache(const RunResult& mesh, int runs)
+    {
+        MeshView view;
+        view.vertices = mesh.vertices.data();
+        view.vertexCount = mesh.vertices.size();
+        view.indices = mesh.indices.data();
+        view.indexCount = mesh.indices.size();
+        const double rawMb = static_cast<double>(view.vertexCount * sizeof(Vertex) + view.indexCount * sizeof(unsigned int))
+            / (1024.0 * 1024.0);
+
+        MeshView compactView = view;
+        compactView.vertices = nullptr;
+        compactView.layout.format = kCompactVertexFormat;
+        const std::vector<unsigned char> compact = QuantizeVertices(mesh.vertices.data(), mesh.vertices.size(),
+            compactView.layout);
+        compactView.quantizedVertices = compact.data();
+
+        std::vector<unsigned short> shortIndices;
+        MeshView shortView = compactView;
+        const bool narrow = mesh.vertices.size() <= kMaxShortIndexVertices;
+        if (narrow) {
+            shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+            shortView.indices = shortIndices.data();
+            shortView.indexSize = sizeof(unsigned short);
+        }
+
+        struct Encoding {
+            const char* label;
+            MeshCacheEncoding encoding;
+            const MeshView* view;
+        };
+        std::vector<Encoding> encodings = {
+            { "raw", MeshCacheEncoding::Raw, &view },
+            { "packed", MeshCacheEncoding::Packed, &view },
+            { "raw q", MeshCacheEncoding::Raw, &compactView },
+            { "packed q", MeshCacheEncoding::Packed, &compactView }
+        };
+        if (narrow) {
+            encodings.push_back({ "raw q16", MeshCacheEncoding::Raw, &shortView });
+            encodings.push_back({ "packed q16", MeshCacheEncoding::Packed, &shortView });
+        }
+
+        int failures = 0;
+        const fs::path path = fs::temp_directory_path() / "loader_bench.cache.mesh";
+        for (const Encoding& encoding : encodings) {
+            double encodeMs = 1e30, decodeMs = 1e30;
+            Mesh decoded;
+            bool ok = true;
+            for (int r = 0; r < runs && ok; ++r) {
+                encodeMs = std::min(encodeMs, TimeMs([&]() {
+                    ok = MeshCache::Write(path.string(), MeshCacheSource{}, *encoding.view, encoding.encoding);
+                }));
+                decodeMs = std::min(decodeMs, TimeMs([&]() {
+                    MeshCache cache;
+                    ok = ok && cache.Open(path.string()) == CacheStatus::Ok && cache.Read(decoded) == CacheStatus::Ok;
+                }));
+            }
+
+            std::error_code ec;
+            const double fileMb = static_cast<double>(fs::file_size(path, ec)) / (1024.0 * 1024.0);
+            std::cout << "  cache " << std::setw(10) << std::left << encoding.label << std::right
+                << "  " << std::setw(8) << fileMb << " MB (" << std::setw(4) << fileMb / rawMb << ")"
+                << "  encode " << std::setw(8) << encodeMs << " ms"
+                << "  decode " << std::setw(8) << decodeMs << " ms"
+                << "  " << std::setw(8) << rawMb / (decodeMs / 1000.0) << " MB/s\n";
+
+            const bool sameVertices = encoding.view == &view ? decoded.vertices == mesh.vertices
+                : decoded.quantizedVertices == compact && decoded.layout.stride == compactView.layout.stride;
+            const bool sameIndices = encoding.view == &shortView ? decoded.shortIndices == shortIndices
+                : decoded.indices == mesh.indices;
+            if (!ok || !sameVertices || !sameIndices) {
+                std::cerr << "  mismatch: " << encoding.label << " cache does not round-trip\n";
+                ++failures;
+            }
+        }
+        fs::remove(path);
+        return failures;
+    }
+
+    // triangles with their smallest index first, sorted, to compare meshes
+    // whose triangle order differs
+    std::vector<std::array<unsigned int, 3>> TriangleSet(const std::vector<unsigned int>& indices)
+    {
+        std::vector<std::array<unsigned int, 3>> triangles(indices.size() / 3);
+        for (size_t t = 0; t < triangles.size(); ++t) {
+            std::array<unsigned int, 3>& triangle = triangles[t];
+            triangle = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    // simulated gpu cost of a mesh: vertex cache, vertex fetch, overdraw
+    void PrintMeshStats(const std::string& label, const std::vector<Vertex>& vertices,
+        const std::vector<unsigned int>& indices, double ms)
+    {
+        const VertexCacheStats cache = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+        const VertexFetchStats fetch = AnalyzeVertexFetch(indices.data(), indices.size(), vertices.size(), sizeof(Vertex));
+        const OverdrawStats overdraw = AnalyzeOverdraw(indices.data(), indices.size(), &vertices[0].position.x,
+            vertices.size(), sizeof(Vertex));
+        std::cout << "  " << std::setw(11) << std::left << label << std::right
+            << "  acmr " << std::setw(5) << cache.acmr << "  atvr " << std::setw(5) << cache.atvr
+            << "  overfetch " << std::setw(5) << fetch.overfetch << "  overdraw " << std::setw(5) << overdraw.overdraw;
+        if (ms > 0.0) std::cout << "  " << std::setw(8) << ms << " ms";
+        std::cout << "\n";
+    }
+
+    // each optimizer pass in loader order: time and simulated effect
+    int BenchOptimize(const RunResult& mesh, int runs)
+    {
+        if (mesh.vertices.empty() || mesh.indices.empty()) return 0;
+        std::vector<Vertex> vertices = mesh.vertices;
+        std::vector<unsigned int> indices = mesh.indices;
+        PrintMeshStats("input", vertices, indices, 0.0);
+
+        std::vector<unsigned int> optimized(indices.size());
+        double ms = 1e30;
+        for (int r = 0; r < runs; ++r) {
+            ms = std::min(ms, TimeMs([&]() {
+                OptimizeVertexCache(optimized.data(), indices.data(), indices.size(), vertices.size());
+            }));
+        }
+        indices.swap(optimized);
+        PrintMeshStats("vcache", vertices, indices, ms);
+
+        ms = 1e30;
+        for (int r = 0; r < runs; ++r) {
+            ms = std::min(ms, TimeMs([&]() {
+                OptimizeOverdraw(optimized.data(), indices.data(), indices.size(), &vertices[0].position.x,
+                    vertices.size(), sizeof(Vertex));
+            }));
+        }
+        indices.swap(optimized);
+        PrintMeshStats("overdraw", vertices, indices, ms);
+
+        std::vector<Vertex> reordered(vertices.size());
+        std::vector<unsigned int> remapped;
+        size_t vertexCount = 0;
+        ms = 1e30;
+        for (int r = 0; r < runs; ++r) {
+            remapped = indices;
+            ms = std::min(ms, TimeMs([&]() {
+                vertexCount = OptimizeVertexFetch(reordered.data(), remapped.data(), remapped.size(),
+                    vertices.data(), vertices.size(), sizeof(Vertex));
+            }));
+        }
+        reordered.resize(vertexCount);
+
+        // the passes may only reorder: same triangles, same vertex data
+        bool same = TriangleSet(indices) == TriangleSet(mesh.indices);
+        for (size_t i = 0; same && i < remapped.size(); ++i) same = reordered[remapped[i]] == vertices[indices[i]];
+        PrintMeshStats("vfetch", reordered, remapped, ms);
+
+        if (!same) {
+            std::cerr << "  mismatch: optimizer passes changed the mesh\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // simplify level after level at half the triangles, as the loader does
+    int BenchLods(const RunResult& mesh, int lodCount)
+    {
+        if (mesh.vertices.empty() || mesh.indices.empty()) return 0;
+        std::vector<unsigned int> level = mesh.indices;
+        std::vector<unsigned int> simplified(level.size());
+        for (int lod = 1; lod < lodCount; ++lod) {
+            float error = 0.0f;
+            size_t count = 0;
+            const double ms = TimeMs([&]() {
+                count = SimplifyMesh(simplified.data(), level.data(), level.size(), mesh.vertices.data(),
+                    mesh.vertices.size(), level.size() / 6 * 3, 1e30f, &error);
+            });
+            std::cout << "  lod " << lod << "       " << std::setw(9) << level.size() / 3 << " -> "
+                << std::setw(9) << count / 3 << " triangles  error " << std::setprecision(5) << error << std::setprecision(2)
+                << "  " << std::setw(8) << ms << " ms\n";
+            for (size_t i = 0; i < count; ++i) {
+                if (simplified[i] >= mesh.vertices.size()) {
+                    std::cerr << "  mismatch: simplifier produced an out of range index\n";
+                    return 1;
+                }
+            }
+            if (count == level.size()) break;
+            level.assign(simplified.begin(), simplified.begin() + count);
+        }
+        return 0;
+    }
+
+    // one stage of the suite, every run's time kept for the percentiles
+    struct StageResult {
+        std::string name;
+        std::vector<double> ms;
+        uint64_t sourceBytes = 0;       // obj bytes the stage stands for, 0 for mesh passes
+        size_t vertices = 0;
+        size_t faces = 0;               // triangles after triangulation
+        AllocationStats allocations;    // of the last run
+    };
+
+    // run setup then f, runs times, timing and counting the allocations of f only
+    template <typename Setup, typename F>
+    StageResult Stage(const std::string& name, int runs, Setup&& setup, F&& f)
+    {
+        StageResult stage;
+        stage.name = name;
+        for (int r = 0; r < runs; ++r) {
+            setup();
+            const AllocationStats before = CurrentAllocations();
+            stage.ms.push_back(TimeMs(f));
+            const AllocationStats after = CurrentAllocations();
+            stage.allocations.count = after.count - before.count;
+            stage.allocations.bytes = after.bytes - before.bytes;
+        }
+        return stage;
+    }
+
+    // heap allocations of the last run per MB of obj, 0 for mesh passes
+    double AllocationsPerMB(const StageResult& stage)
+    {
+        if (stage.sourceBytes == 0) return 0.0;
+        return static_cast<double>(stage.allocations.count) / (static_cast<double>(stage.sourceBytes) / (1024.0 * 1024.0));
+    }
+
+    // items per second at the median time, 0 when the stage has no items
+    double Rate(double items, const StageResult& stage)
+    {
+        const double ms = Percentile(stage.ms, 50.0);
+        return ms > 0.0 ? items / (ms / 1000.0) : 0.0;
+    }
+
+    void PrintStage(const StageResult& stage)
+    {
+        std::cout << "  " << std::setw(12) << std::left << stage.name << std::right
+            << "  p50 " << std::setw(9) << Percentile(stage.ms, 50.0) << " ms"
+            << "  p90 " << std::setw(9) << Percentile(stage.ms, 90.0) << " ms"
+            << "  p99 " << std::setw(9) << Percentile(stage.ms, 99.0) << " ms";
+        if (stage.sourceBytes > 0) {
+            std::cout << "  " << std::setw(8) << Rate(static_cast<double>(stage.sourceBytes) / (1024.0 * 1024.0), stage) << " MB/s";
+        }
+        else {
+            std::cout << "  " << std::setw(13) << "";
+        }
+        std::cout << "  " << std::setw(7) << Rate(static_cast<double>(stage.vertices), stage) / 1e6 << " Mverts/s"
+            << "  " << std::setw(7) << Rate(static_cast<double>(stage.faces), stage) / 1e6 << " Mfaces/s"
+            << "  " << std::setw(8) << stage.allocations.count << " allocs"
+            << "  " << std::setw(8) << static_cast<double>(stage.allocations.bytes) / (1024.0 * 1024.0) << " MB";
+        if (stage.sourceBytes > 0) std::cout << "  " << std::setw(8) << AllocationsPerMB(stage) << " allocs/MB";
+        std::cout << "\n";
+    }
+
+    void WriteStage(JsonWriter& json, const StageResult& stage)
+    {
+        json.BeginObject();
+        json.Value("name", stage.name);
+        json.Value("runs", static_cast<uint64_t>(stage.ms.size()));
+        json.Value("minMs", Percentile(stage.ms, 0.0));
+        double total = 0.0;
+        for (double ms : stage.ms) total += ms;
+        json.Value("meanMs", stage.ms.empty() ? 0.0 : total / stage.ms.size());
+        json.Value("p50Ms", Percentile(stage.ms, 50.0));
+        json.Value("p90Ms", Percentile(stage.ms, 90.0));
+        json.Value("p99Ms", Percentile(stage.ms, 99.0));
+        json.Value("maxMs", Percentile(stage.ms, 100.0));
+        if (stage.sourceBytes > 0) {
+            json.Value("mbPerSecond", Rate(static_cast<double>(stage.sourceBytes) / (1024.0 * 1024.0), stage));
+        }
+        json.Value("verticesPerSecond", Rate(static_cast<double>(stage.vertices), stage));
+        json.Value("facesPerSecond", Rate(static_cast<double>(stage.faces), stage));
+        json.Value("allocations", stage.allocations.count);
+        json.Value("allocatedBytes", stage.allocations.bytes);
+        if (stage.sourceBytes > 0) json.Value("allocationsPerMB", AllocationsPerMB(stage));
+        json.EndObject();
+    }
+
+    // the regression suite for one file: GetVertices without a cache (mapped
+    // and streamed), into an empty store (cold) and from a raw and a packed store (warm), then
+    // each mesh pass on the parsed mesh. stages go to the console and json
+    int RunSuite(const std::string& path, uint64_t fileBytes, int runs, JsonWriter& json)
+    {
+        std::vector<StageResult> stages;
+        std::unique_ptr<Loader> loader;
+        auto newLoader = [&](CacheStore* store, bool packed) {
+            loader.reset();
+            loader.reset(new Loader());
+            loader->useCache = store != nullptr;
+            loader->cacheStore = store;
+            loader->compressCache = packed;
+        };
+
+        stages.push_back(Stage("parse stream", runs,
+            [&]() { newLoader(nullptr, false); loader->parseMode = ParseMode::Stream; },
+            [&]() { loader->GetVertices(path); }));
+        stages.push_back(Stage("parse", runs, [&]() { newLoader(nullptr, false); },
+            [&]() { loader->GetVertices(path); }));
+        std::vector<Vertex> vertices = std::move(loader->vertices);
+        std::vector<unsigned int> indices = std::move(loader->indices);
+        loader.reset();
+        if (vertices.empty() || indices.empty()) {
+            std::cerr << "  " << path << " has no triangles, skipping the suite\n";
+            return 1;
+        }
+
+        // files from obj_generator carry the checksum the parse must reproduce
+        int failures = 0;
+        MeshChecksum expected;
+        if (ReadChecksum(ChecksumPath(path), expected)
+            && ChecksumMesh(vertices.data(), vertices.size(), indices.data(), indices.size()) != expected) {
+            std::cerr << "  mismatch: parsed mesh differs from " << ChecksumPath(path) << "\n";
+            ++failures;
+        }
+
+        const fs::path storeRoot = fs::temp_directory_path() / "loader_bench.suite";
+        const std::string rawDirectory = (storeRoot / "raw").string();
+        const std::string packedDirectory = (storeRoot / "packed").string();
+        std::unique_ptr<CacheStore> store;
+        auto freshStore = [&](const std::string& directory) {
+            store.reset();
+            std::error_code ec;
+            fs::remove_all(directory, ec);
+            store.reset(new CacheStore(directory));
+        };
+
+        stages.push_back(Stage("cold", runs, [&]() { freshStore(rawDirectory); newLoader(store.get(), false); },
+            [&]() { loader->GetVertices(path); }));
+        stages.push_back(Stage("warm raw", runs, [&]() { newLoader(store.get(), false); },
+            [&]() { loader->GetVertices(path); }));
+        const bool rawHit = store->Stats().hits == static_cast<uint64_t>(runs);
+
+        freshStore(packedDirectory);
+        newLoader(store.get(), true);
+        loader->GetVertices(path);
+        stages.push_back(Stage("warm packed", runs, [&]() { newLoader(store.get(), true); },
+            [&]() { loader->GetVertices(path); }));
+        const bool packedHit = store->Stats().hits == static_cast<uint64_t>(runs);
+        loader.reset();
+        store.reset();
+        std::error_code ec;
+        fs::remove_all(storeRoot, ec);
+
+        for (StageResult& stage : stages) {
+            stage.sourceBytes = fileBytes;
+            stage.vertices = vertices.size();
+            stage.faces = indices.size() / 3;
+        }
+
+        // passes in loader order, each from a fresh copy of its input
+        const size_t passBegin = stages.size();
+        std::vector<unsigned int> work;
+        std::vector<unsigned int> vcacheIndices = indices;
+        OptimizeVertexCache(vcacheIndices.data(), vcacheIndices.data(), vcacheIndices.size(), vertices.size());
+        stages.push_back(Stage("vcache", runs, [&]() { work = indices; },
+            [&]() { OptimizeVertexCache(work.data(), work.data(), work.size(), vertices.size()); }));
+        stages.push_back(Stage("overdraw", runs, [&]() { work = vcacheIndices; },
+            [&]() {
+                OptimizeOverdraw(work.data(), work.data(), work.size(), &vertices[0].position.x,
+                    vertices.size(), sizeof(Vertex));
+            }));
+        std::vector<Meshlet> meshlets;
+        stages.push_back(Stage("meshlets", runs, [&]() { work = vcacheIndices; meshlets.clear(); },
+            [&]() {
+                meshlets = BuildMeshlets(work.data(), work.data(), work.size(), &vertices[0].position.x,
+                    vertices.size(), sizeof(Vertex));
+            }));
+        std::vector<unsigned int> simplified(indices.size());
+        stages.push_back(Stage("simplify", runs, []() {},
+            [&]() {
+                SimplifyMesh(simplified.data(), vcacheIndices.data(), vcacheIndices.size(), vertices.data(),
+                    vertices.size(), vcacheIndices.size() / 6 * 3, 1e30f);
+            }));
+        std::vector<Vertex> reordered(vertices.size());
+        stages.push_back(Stage("vfetch", runs, [&]() { work = vcacheIndices; },
+            [&]() {
+                OptimizeVertexFetch(reordered.data(), work.data(), work.size(), vertices.data(),
+                    vertices.size(), sizeof(Vertex));
+            }));
+        std::vector<unsigned char> quantized;
+        stages.push_back(Stage("quantize", runs, [&]() { quantized.clear(); },
+            [&]() {
+                VertexLayout layout;
+                layout.format = kCompactVertexFormat;
+                quantized = QuantizeVertices(vertices.data(), vertices.size(), layout);
+            }));
+        for (size_t i = passBegin; i < stages.size(); ++i) {
+            stages[i].vertices = vertices.size();
+            stages[i].faces = indices.size() / 3;
+        }
+
+        const uint64_t peakRss = PeakRssBytes();
+        for (const StageResult& stage : stages) PrintStage(stage);
+        std::cout << "  peak rss " << static_cast<double>(peakRss) / (1024.0 * 1024.0) << " MB\n";
+
+        json.BeginObject();
+        json.Value("path", path);
+        json.Value("bytes", fileBytes);
+        json.Value("vertices", static_cast<uint64_t>(vertices.size()));
+        json.Value("faces", static_cast<uint64_t>(indices.size() / 3));
+        json.Value("peakRssBytes", peakRss);
+        json.BeginArray("stages");
+        for (const StageResult& stage : stages) WriteStage(json, stage);
+        json.EndArray();
+        json.EndObject();
+
+        if (!rawHit || !packedHit) {
+            std::cerr << "  mismatch: warm loads did not come back from the cache\n";
+            ++failures;
+        }
+        return failures;
+    }
+
+    // stream, then mapped at 1 thread, then either all threads or a 1..N sweep
+    std::vector<Config> MakeConfigs(unsigned int maxThreads, bool scaling)
+    {
+        std::vector<Config> configs;
+        configs.push_back({ "stream", ParseMode::Stream, 1 });
+        configs.push_back({ "mapped x1", ParseMode::Mapped, 1 });
+
+        if (scaling) {
+            for (unsigned int t = 2; t < maxThreads; t *= 2) {
+                configs.push_back({ "mapped x" + std::to_string(t), ParseMode::Mapped, t });
+            }
+        }
+        if (maxThreads > 1) {
+            configs.push_back({ "mapped x" + std::to_string(maxThreads), ParseMode::Mapped, maxThreads });
+        }
+        return configs;
+    }
+
+    int Usage(const std::string& problem)
+    {
+        if (!problem.empty()) std::cerr << "Error: " << problem << "\n";
+        std::cerr << "usage: loader_bench [--runs N] [--threads N] [--scaling] [--cache] [--optimize] [--lods N] [--numbers COUNT] [--codecs]\n"
+            << "                    [--parse-cases] [--suite] [--json report.json] [--trace trace.json] [--corpus DIR] file.obj [file.obj ...]\n";
+        return 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // only the loader's warnings, its per-load messages would bury the report
+    Log::SetLevel(LogLevel::Warning);
+
+    int runs = 5;
+    int numbers = 0;
+    unsigned int threads = 0;
+    bool scaling = false;
+    bool cache = false;
+    bool optimize = false;
+    int lods = 0;
+    bool suite = false;
+    bool codecs = false;
+    bool parseCases = false;
+    std::string jsonPath;
+    std::string tracePath;
+    std::vector<std::string> files;
+
+    // a typo or a missing value must not end up as an input file
+    const std::string valueOptions[] = { "--runs", "--numbers", "--threads", "--lods", "--json", "--trace", "--corpus" };
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (std::find(std::begin(valueOptions), std::end(valueOptions), arg) != std::end(valueOptions) && i + 1 >= argc) {
+            return Usage(arg + " needs a value");
+        }
+        if (arg == "--runs") runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--numbers") numbers = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads") threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--scaling") scaling = true;
+        else if (arg == "--cache") cache = true;
+        else if (arg == "--optimize") optimize = true;
+        else if (arg == "--lods") lods = std::max(2, std::atoi(argv[++i]));
+        else if (arg == "--suite") suite = true;
+        else if (arg == "--codecs") codecs = true;
+        else if (arg == "--parse-cases") parseCases = true;
+        else if (arg == "--json") jsonPath = argv[++i];
+        else if (arg == "--trace") {
+            tracePath = argv[++i];
+            if (!PROFILER_ENABLED) {
+                std::cerr << "Warning: built with PROFILER_ENABLED=0, no trace is written\n";
+                tracePath.clear();
+            }
+        }
+        else if (arg == "--corpus") {
+            // every .obj in the directory, in name order so reports line up
+            std::vector<std::string> corpus;
+            std::error_code ec;
+            for (const fs::directory_entry& entry : fs::directory_iterator(argv[++i], ec)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".obj") corpus.push_back(entry.path().string());
+            }
+            if (ec) std::cerr << "Error: Could not read corpus directory: " << argv[i] << "\n";
+            std::sort(corpus.begin(), corpus.end());
+            files.insert(files.end(), corpus.begin(), corpus.end());
+        }
+        else if (arg.size() > 1 && arg[0] == '-') return Usage("unknown option " + arg);
+        else files.push_back(arg);
+    }
+
+    if (files.empty() && numbers == 0 && !codecs && !parseCases) return Usage(std::string());
+
+    const std::vector<Config> configs = MakeConfigs(ThreadPool::ResolveThreadCount(threads), scaling);
+
+    if (!tracePath.empty()) {
+        Profiler::NameThread("main");
+        Profiler::Start();
+    }
+
+    int failures = 0;
+    if (numbers > 0) failures += BenchNumbers(numbers);
+    if (codecs) failures += CheckCodecs();
+    if (parseCases) failures += CheckParseCases();
+
+    JsonWriter json;
+    json.BeginObject();
+    json.Value("runs", static_cast<uint64_t>(runs));
+    json.Value("threads", static_cast<uint64_t>(ThreadPool::ResolveThreadCount(threads)));
+    json.BeginArray("files");
+
+    for (const std::string& path : files) {
+        std::error_code ec;
+        double mb = static_cast<double>(fs::file_size(path, ec)) / (1024.0 * 1024.0);
+        if (ec) {
+            std::cerr << "Error: Could not stat file: " << path << "\n";
+            ++failures;
+            continue;
+        }
+
+        std::cout << path << " (" << std::fixed << std::setprecision(2) << mb << " MB, " << runs << " runs)\n";
+        if (suite) {
+            failures += RunSuite(path, fs::file_size(path, ec), runs, json);
+            continue;
+        }
+
+        RunResult reference;
+        double singleThreadMs = 0.0;
+        for (const Config& config : configs) {
+            RunResult result = Run(path, config, runs);
+            if (config.mode == ParseMode::Mapped && config.threads == 1) singleThreadMs = result.bestMs;
+
+            std::cout << "  " << std::setw(11) << std::left << config.label << std::right
+                << "  best " << std::setw(9) << result.bestMs << " ms"
+                << "  mean " << std::setw(9) << result.meanMs << " ms"
+                << "  " << std::setw(8) << mb / (result.bestMs / 1000.0) << " MB/s";
+            if (config.mode == ParseMode::Mapped && singleThreadMs > 0.0) {
+                std::cout << "  " << std::setw(5) << singleThreadMs / result.bestMs << "x";
+            }
+            std::cout << "  " << result.vertices.size() << " vertices, " << result.indices.size() << " indices\n";
+
+            if (&config == &configs.front()) {
+                reference = std::move(result);
+            }
+            else if (result.vertices != reference.vertices || result.indices != reference.indices) {
+                std::cerr << "  mismatch: " << config.label << " output differs from " << configs.front().label << "\n";
+                ++failures;
+            }
+        }
+        if (cache) failures += BenchCache(reference, runs);
+        if (optimize) failures += BenchOptimize(reference, runs);
+        if (lods > 0) failures += BenchLods(reference, lods);
+    }
+
+    json.EndArray();
+    json.Value("peakRssBytes", PeakRssBytes());
+    json.EndObject();
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath, std::ios::binary | std::ios::trunc);
+        out << json.Text();
+        if (!out.good()) {
+            std::cerr << "Error: Could not write " << jsonPath << "\n";
+            ++failures;
+        }
+    }
+
+    if (!tracePath.empty()) {
+        Profiler::Stop();
+        if (!Profiler::WriteChromeTrace(tracePath)) {
+            std::cerr << "Error: Could not write " << tracePath << "\n";
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
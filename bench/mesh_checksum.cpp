@@ -0,0 +1,56 @@
+#include "mesh_checksum.h"
+#include "../include/hash.h"
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    // first word of a sidecar, bump the number if the hashed streams change
+    const char kChecksumTag[] = "objmesh-checksum 1";
+}
+
+MeshChecksum ChecksumMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+    static_assert(sizeof(Vertex) == 32 && sizeof(unsigned int) == 4, "checksums hash the packed records");
+    MeshChecksum checksum;
+    checksum.vertexCount = vertexCount;
+    checksum.indexCount = indexCount;
+    checksum.vertexHash = Hash64::Of(vertices, vertexCount * sizeof(Vertex));
+    checksum.indexHash = Hash64::Of(indices, indexCount * sizeof(unsigned int));
+    return checksum;
+}
+
+std::string ChecksumString(const MeshChecksum& checksum)
+{
+    char text[160];
+    std::snprintf(text, sizeof(text), "vertices %" PRIu64 " indices %" PRIu64 " vertexHash %016" PRIx64 " indexHash %016" PRIx64,
+        checksum.vertexCount, checksum.indexCount, checksum.vertexHash, checksum.indexHash);
+    return text;
+}
+
+std::string ChecksumPath(const std::string& objPath)
+{
+    return objPath + ".sum";
+}
+
+bool WriteChecksum(const std::string& path, const MeshChecksum& checksum)
+{
+    std::ofstream out(path, std::ios::trunc);
+    out << kChecksumTag << " " << ChecksumString(checksum) << "\n";
+    return out.good();
+}
+
+bool ReadChecksum(const std::string& path, MeshChecksum& checksum)
+{
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line.compare(0, sizeof(kChecksumTag) - 1, kChecksumTag) != 0) return false;
+
+    std::istringstream fields(line.substr(sizeof(kChecksumTag) - 1));
+    std::string vertices, indices, vertexHash, indexHash;
+    fields >> vertices >> checksum.vertexCount >> indices >> checksum.indexCount
+        >> vertexHash >> std::hex >> checksum.vertexHash >> indexHash >> checksum.indexHash;
+    return !fields.fail() && vertices == "vertices" && indices == "indices"
+        && vertexHash == "vertexHash" && indexHash == "indexHash";
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../include/vertex.h"
+
+// fingerprint of the mesh the loader parses from an obj file, with no
+// optimizer passes: the Vertex records and the uint32 indices, each
+// stream hashed with xxh64 in order. obj_generator computes it for the
+// files it writes and leaves it next to them as "<file>.sum", so a load of
+// those files can be checked without keeping a reference mesh around.
+struct MeshChecksum {
+    uint64_t vertexCount = 0;
+    uint64_t indexCount = 0;
+    uint64_t vertexHash = 0;
+    uint64_t indexHash = 0;
+
+    bool operator==(const MeshChecksum& other) const
+    {
+        return vertexCount == other.vertexCount && indexCount == other.indexCount
+            && vertexHash == other.vertexHash && indexHash == other.indexHash;
+    }
+    bool operator!=(const MeshChecksum& other) const { return !(*this == other); }
+};
+
+MeshChecksum ChecksumMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+// "vertices N indices N vertexHash HEX indexHash HEX"
+std::string ChecksumString(const MeshChecksum& checksum);
+
+// sidecar file of an obj
+std::string ChecksumPath(const std::string& objPath);
+
+bool WriteChecksum(const std::string& path, const MeshChecksum& checksum);
+
+// false if the file is missing or not a checksum
+bool ReadChecksum(const std::string& path, MeshChecksum& checksum);
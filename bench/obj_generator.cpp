@@ -0,0 +1,541 @@
+// deterministic synthetic obj corpus for load testing. the same options and
+// seed write the same bytes on every platform: the random generator is our
+// own, coordinates sit on a 1/1024 grid and are printed exactly, and nothing
+// that ends up in the file goes through libm rounding.
+//
+// the mesh is a run of blocks. a block is a grid of vertices (with a vt and
+// a vn each when those are on) whose cells become one quad or two
+// triangles, and ngon faces are rings of fresh vertices written right
+// before the face, convex or (with --concave) star shaped. faces only refer
+// to their own block, so what the loader will build from the file (vertices
+// in first-use order, ear clipped triangles) is tracked with per-block state and the checksum of files
+// of any size is known once writing finishes. it is written next to the
+// file as "<file>.sum", see mesh_checksum.h.
+//
+// the mesh and the text are drawn from separate random streams: line
+// endings, whitespace, comments, relative indices and the order of the
+// v/vt/vn lines never change the mesh, so files that differ only in those
+// must load to the same checksum.
+#include "mesh_checksum.h"
+#include "../include/hash.h"
+#include "../include/loader.h"
+#include "../include/log.h"
+#include "../include/polygon_triangulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+    // coordinates are integers in units of 1/kUnit
+    constexpr int32_t kUnit = 1024;
+
+    // text is handed to the file in pieces of about this size
+    constexpr size_t kFlushBytes = 1 << 20;
+
+    // vertex spacing inside a block grid, and the ngon ring radius, in units
+    constexpr int32_t kGridSpacing = 64;
+    constexpr int32_t kRingRadius = 256;
+
+    struct Options {
+        uint64_t seed = 1;
+        uint64_t faces = 0;             // stop targets, whichever is reached first
+        uint64_t vertices = 0;
+        uint64_t bytes = 0;
+        unsigned int grid = 64;         // block grid side, in vertices
+        double quadRatio = 0.5;         // cells written as a quad rather than two triangles
+        double ngonRatio = 0.0;         // chance of an ngon before each cell
+        unsigned int maxSides = 8;
+        double concaveRatio = 0.0;      // ngons written as stars rather than convex rings
+        bool uvs = true;
+        bool normals = true;
+        double negativeRatio = 0.0;     // faces written with relative indices
+        double commentRatio = 0.0;      // blocks preceded by a comment block
+        unsigned int commentLines = 64;
+        bool crlf = false;
+        bool messy = false;             // whitespace runs, tabs, trailing and blank lines
+        bool check = false;             // load the result and compare checksums
+        std::string path;
+    };
+
+    // splitmix64, identical everywhere unlike the std distributions
+    class Random {
+    public:
+        explicit Random(uint64_t seed) : state(seed) {}
+
+        uint64_t Next()
+        {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        // uniform in [low, high]
+        int32_t Range(int32_t low, int32_t high)
+        {
+            const uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(high) - low) + 1;
+            return static_cast<int32_t>(low + static_cast<int64_t>(((Next() >> 32) * span) >> 32));
+        }
+
+        bool Chance(double p)
+        {
+            return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0) < p;
+        }
+
+    private:
+        uint64_t state;
+    };
+
+    // one face corner: attribute indices (0-based, -1 when absent), the
+    // vertex the loader builds from them, and where the loader's id for it
+    // is tracked
+    struct Corner {
+        int64_t position;
+        int64_t uv;
+        int64_t normal;
+        Vertex vertex;
+        uint32_t* id;
+    };
+
+    class Generator {
+    public:
+        Generator(const Options& options, std::FILE* file)
+            : options(options), file(file), mesh(options.seed), text(options.seed ^ 0x5bd1e9955bd1e995ull)
+        {
+        }
+
+        bool Run()
+        {
+            Line("# synthetic obj, seed " + std::to_string(options.seed));
+            while (ok && !Done(true)) Block();
+            Flush();
+            return ok;
+        }
+
+        MeshChecksum Checksum() const
+        {
+            MeshChecksum checksum;
+            checksum.vertexCount = vertexCount;
+            checksum.indexCount = indexCount;
+            checksum.vertexHash = vertexHash.Digest();
+            checksum.indexHash = indexHash.Digest();
+            return checksum;
+        }
+
+        uint64_t Written() const { return written + buffer.size(); }
+        uint64_t PositionRecords() const { return positionCount; }
+        uint64_t FaceRecords() const { return faceCount; }
+
+    private:
+        // vertex targets only end a run between blocks, so every written
+        // grid vertex gets used
+        bool Done(bool blockStart) const
+        {
+            if (options.faces && faceCount >= options.faces) return true;
+            if (options.bytes && Written() >= options.bytes) return true;
+            return blockStart && options.vertices && static_cast<uint64_t>(positionCount) >= options.vertices;
+        }
+
+        void Block()
+        {
+            if (options.commentRatio > 0.0 && text.Chance(options.commentRatio)) Comments();
+            Line("g block" + std::to_string(blockCount));
+
+            const uint32_t side = options.grid;
+            const int32_t z = static_cast<int32_t>(blockCount % 64) * 256;
+            ++blockCount;
+
+            // grid vertices, each with its own vt and vn
+            const size_t count = static_cast<size_t>(side) * side;
+            units.resize(count * 8);
+            gridVertices.resize(count);
+            for (uint32_t r = 0; r < side; ++r) {
+                for (uint32_t c = 0; c < side; ++c) {
+                    int32_t* u = &units[(static_cast<size_t>(r) * side + c) * 8];
+                    u[0] = static_cast<int32_t>(c) * kGridSpacing + mesh.Range(-8, 8);
+                    u[1] = static_cast<int32_t>(r) * kGridSpacing + mesh.Range(-8, 8);
+                    u[2] = z + mesh.Range(0, 32);
+                    u[3] = static_cast<int32_t>(c) * 16;
+                    u[4] = static_cast<int32_t>(r) * 16;
+                    u[5] = mesh.Range(-64, 64);
+                    u[6] = mesh.Range(-64, 64);
+                    u[7] = kUnit;
+                }
+            }
+            for (size_t i = 0; i < count; ++i) gridVertices[i] = MakeVertex(&units[i * 8]);
+
+            // interleaved per vertex, or all positions then all uvs then all normals
+            const int64_t positionBase = positionCount, uvBase = uvCount, normalBase = normalCount;
+            if (text.Chance(0.5)) {
+                for (size_t i = 0; i < count; ++i) WriteVertex(&units[i * 8]);
+            }
+            else {
+                for (size_t i = 0; i < count; ++i) Record("v", &units[i * 8], 3);
+                if (options.uvs) for (size_t i = 0; i < count; ++i) Record("vt", &units[i * 8 + 3], 2);
+                if (options.normals) for (size_t i = 0; i < count; ++i) Record("vn", &units[i * 8 + 5], 3);
+            }
+            positionCount += count;
+            if (options.uvs) uvCount += count;
+            if (options.normals) normalCount += count;
+
+            gridIds.assign(count, kNoId);
+            for (uint32_t r = 0; r + 1 < side && ok; ++r) {
+                for (uint32_t c = 0; c + 1 < side && ok; ++c) {
+                    if (Done(false)) return;
+                    if (options.ngonRatio > 0.0 && mesh.Chance(options.ngonRatio)) {
+                        Ring(&units[(static_cast<size_t>(r) * side + c) * 8]);
+                    }
+
+                    const size_t a = static_cast<size_t>(r) * side + c;
+                    const size_t corners[4] = { a, a + 1, a + side + 1, a + side };
+                    Corner face[4];
+                    for (int k = 0; k < 4; ++k) {
+                        const size_t i = corners[k];
+                        face[k] = { positionBase + static_cast<int64_t>(i),
+                            options.uvs ? uvBase + static_cast<int64_t>(i) : -1,
+                            options.normals ? normalBase + static_cast<int64_t>(i) : -1,
+                            gridVertices[i], &gridIds[i] };
+                    }
+                    if (mesh.Chance(options.quadRatio)) {
+                        Face(face, 4);
+                    }
+                    else {
+                        Face(face, 3);
+                        const Corner second[3] = { face[0], face[2], face[3] };
+                        Face(second, 3);
+                    }
+                }
+            }
+        }
+
+        // an ngon of fresh vertices on a circle above the cell, or a star
+        // whose odd corners sit on a circle of half the radius
+        void Ring(const int32_t* cell)
+        {
+            const int sides = mesh.Range(5, static_cast<int32_t>(options.maxSides));
+            const bool star = options.concaveRatio > 0.0 && mesh.Chance(options.concaveRatio);
+            ringUnits.resize(static_cast<size_t>(sides) * 8);
+            ringIds.assign(static_cast<size_t>(sides), kNoId);
+            std::vector<Corner> face(static_cast<size_t>(sides));
+            for (int k = 0; k < sides; ++k) {
+                // snapped to the unit grid, which keeps it strictly convex
+                // (or a simple star) up to the 32 sides --max-sides allows
+                const double angle = 6.283185307179586 * k / sides;
+                const double radius = star && (k & 1) ? kRingRadius / 2 : kRingRadius;
+                int32_t* u = &ringUnits[static_cast<size_t>(k) * 8];
+                u[0] = cell[0] + static_cast<int32_t>(std::lround(radius * std::cos(angle)));
+                u[1] = cell[1] + static_cast<int32_t>(std::lround(radius * std::sin(angle)));
+                u[2] = cell[2] + 128;
+                u[3] = cell[3] + k;
+                u[4] = cell[4];
+                u[5] = 0;
+                u[6] = 0;
+                u[7] = kUnit;
+                WriteVertex(u);
+                face[k] = { positionCount, options.uvs ? uvCount : -1, options.normals ? normalCount : -1,
+                    MakeVertex(u), &ringIds[k] };
+                ++positionCount;
+                if (options.uvs) ++uvCount;
+                if (options.normals) ++normalCount;
+            }
+            Face(face.data(), face.size());
+        }
+
+        // write an f record and follow the loader: corners get ids on first
+        // use, then the face is ear clipped, which for convex faces is the
+        // fan from its first corner
+        void Face(const Corner* corners, size_t count)
+        {
+            const bool relative = options.negativeRatio > 0.0 && text.Chance(options.negativeRatio);
+            buffer += "f";
+            for (size_t k = 0; k < count; ++k) {
+                const Corner& corner = corners[k];
+                Gap();
+                Index(corner.position, positionCount, relative);
+                if (corner.uv >= 0 || corner.normal >= 0) {
+                    buffer += '/';
+                    if (corner.uv >= 0) Index(corner.uv, uvCount, relative);
+                }
+                if (corner.normal >= 0) {
+                    buffer += '/';
+                    Index(corner.normal, normalCount, relative);
+                }
+                if (*corner.id == kNoId) {
+                    *corner.id = static_cast<uint32_t>(vertexCount++);
+                    vertexHash.Update(&corner.vertex, sizeof(Vertex));
+                }
+            }
+            EndLine();
+            ++faceCount;
+
+            facePositions.resize(count);
+            faceTriangles.resize(3 * count);
+            for (size_t k = 0; k < count; ++k) facePositions[k] = corners[k].vertex.position;
+            const size_t triangles = TriangulatePolygon(facePositions.data(), count, faceTriangles.data(), polygonScratch);
+            for (size_t t = 0; t < triangles; ++t) {
+                const uint32_t* corner = &faceTriangles[t * 3];
+                const uint32_t triangle[3] = { *corners[corner[0]].id, *corners[corner[1]].id, *corners[corner[2]].id };
+                indexHash.Update(triangle, sizeof(triangle));
+                indexCount += 3;
+            }
+        }
+
+        void Comments()
+        {
+            static const char kWords[] = "lorem ipsum dolor sit amet consectetur adipiscing elit sed do eiusmod tempor ";
+            for (unsigned int i = 0; i < options.commentLines; ++i) {
+                std::string line = "#";
+                const int32_t length = text.Range(40, 200);
+                while (static_cast<int32_t>(line.size()) < length) line += kWords[line.size() % (sizeof(kWords) - 1)];
+                Line(line);
+            }
+        }
+
+        Vertex MakeVertex(const int32_t* u) const
+        {
+            const float scale = 1.0f / kUnit;
+            Vertex vertex;
+            vertex.position = glm::vec3(u[0] * scale, u[1] * scale, u[2] * scale);
+            if (options.uvs) vertex.uv = glm::vec2(u[3] * scale, u[4] * scale);
+            if (options.normals) vertex.normal = glm::vec3(u[5] * scale, u[6] * scale, u[7] * scale);
+            return vertex;
+        }
+
+        void WriteVertex(const int32_t* u)
+        {
+            Record("v", u, 3);
+            if (options.uvs) Record("vt", u + 3, 2);
+            if (options.normals) Record("vn", u + 5, 3);
+        }
+
+        void Record(const char* keyword, const int32_t* u, int count)
+        {
+            buffer += keyword;
+            for (int i = 0; i < count; ++i) {
+                Gap();
+                Fixed(u[i]);
+            }
+            EndLine();
+        }
+
+        // 1-based, or relative to the records written so far
+        void Index(int64_t index, int64_t written, bool relative)
+        {
+            buffer += std::to_string(relative ? index - written : index + 1);
+        }
+
+        // units / kUnit in plain decimal, exact and without trailing zeros
+        void Fixed(int32_t value)
+        {
+            if (value < 0) buffer += '-';
+            const uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+            buffer += std::to_string(magnitude / kUnit);
+            uint64_t fraction = static_cast<uint64_t>(magnitude % kUnit) * 9765625;   // 10 decimal digits
+            if (fraction == 0) return;
+            char digits[11];
+            for (int i = 9; i >= 0; --i) {
+                digits[i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            int length = 10;
+            while (digits[length - 1] == '0') --length;
+            buffer += '.';
+            buffer.append(digits, static_cast<size_t>(length));
+        }
+
+        // field separator, the first one also ends the keyword
+        void Gap()
+        {
+            if (!options.messy) {
+                buffer += ' ';
+                return;
+            }
+            buffer += ' ';
+            const int32_t extra = text.Range(0, 3);
+            for (int32_t i = 0; i < extra; ++i) buffer += text.Chance(0.5) ? ' ' : '\t';
+        }
+
+        void EndLine()
+        {
+            if (options.messy && text.Chance(0.1)) buffer += text.Chance(0.5) ? " \t" : "  ";
+            buffer += options.crlf ? "\r\n" : "\n";
+            if (options.messy && text.Chance(0.02)) {
+                buffer += text.Chance(0.5) ? "\t  " : "";
+                buffer += options.crlf ? "\r\n" : "\n";
+            }
+            if (buffer.size() >= kFlushBytes) Flush();
+        }
+
+        void Line(const std::string& line)
+        {
+            buffer += line;
+            EndLine();
+        }
+
+        void Flush()
+        {
+            if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) ok = false;
+            written += buffer.size();
+            buffer.clear();
+        }
+
+        static constexpr uint32_t kNoId = 0xffffffffu;
+
+        const Options& options;
+        std::FILE* file;
+        Random mesh;        // geometry and face structure
+        Random text;        // formatting only
+        std::string buffer;
+        uint64_t written = 0;
+        bool ok = true;
+
+        int64_t positionCount = 0, uvCount = 0, normalCount = 0;
+        uint64_t faceCount = 0;
+        uint64_t blockCount = 0;
+
+        std::vector<int32_t> units;         // 8 per grid vertex: position, uv, normal
+        std::vector<Vertex> gridVertices;
+        std::vector<uint32_t> gridIds;      // loader vertex id per grid vertex once used
+        std::vector<int32_t> ringUnits;
+        std::vector<uint32_t> ringIds;
+        std::vector<glm::vec3> facePositions;
+        std::vector<uint32_t> faceTriangles;
+        PolygonScratch polygonScratch;
+
+        uint64_t vertexCount = 0;
+        uint64_t indexCount = 0;
+        Hash64 vertexHash;
+        Hash64 indexHash;
+    };
+
+    // "123", "64K", "10M", "2G"
+    uint64_t ParseSize(const std::string& text)
+    {
+        char* end = nullptr;
+        uint64_t value = std::strtoull(text.c_str(), &end, 10);
+        switch (end ? *end : '\0') {
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+        default: break;
+        }
+        return value;
+    }
+
+    // parse the file back serially and in chunks and compare with what was
+    // written. four threads split files over a few MB into chunks whatever
+    // the core count, so relative indices get resolved across chunk starts
+    int Check(const std::string& path, const MeshChecksum& expected)
+    {
+        struct CheckConfig {
+            const char* label;
+            ParseMode mode;
+            unsigned int threads;
+        };
+        const CheckConfig configs[] = {
+            { "stream", ParseMode::Stream, 1 },
+            { "mapped", ParseMode::Mapped, 1 },
+            { "mapped x4", ParseMode::Mapped, 4 },
+        };
+
+        int failures = 0;
+        for (const CheckConfig& config : configs) {
+            Loader loader;
+            loader.useCache = false;
+            loader.parseMode = config.mode;
+            loader.threadCount = config.threads;
+            loader.GetVertices(path);
+
+            const MeshChecksum loaded = ChecksumMesh(loader.vertices.data(), loader.vertices.size(),
+                loader.indices.data(), loader.indices.size());
+            const char* label = config.label;
+            if (loaded == expected) {
+                std::cout << "  check " << label << " ok\n";
+            }
+            else {
+                std::cerr << "  check " << label << " mismatch: " << ChecksumString(loaded) << "\n";
+                ++failures;
+            }
+        }
+        return failures;
+    }
+
+    int Usage(const std::string& problem)
+    {
+        if (!problem.empty()) std::cerr << "Error: " << problem << "\n";
+        std::cerr << "usage: obj_generator [--seed N] [--faces N] [--vertices N] [--size BYTES[K|M|G]] [--grid N]\n"
+            << "                     [--quads RATIO] [--ngons RATIO] [--max-sides N] [--concave RATIO]\n"
+            << "                     [--no-uvs] [--no-normals] [--negative RATIO] [--comments RATIO]\n"
+            << "                     [--comment-lines N] [--crlf] [--messy] [--check] out.obj\n";
+        return 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // only the loader's warnings, its per-load messages would bury the report
+    Log::SetLevel(LogLevel::Warning);
+
+    // a typo or a missing value must not end up as the output path
+    const std::string valueOptions[] = { "--seed", "--faces", "--vertices", "--size", "--grid", "--quads", "--ngons",
+        "--max-sides", "--concave", "--negative", "--comments", "--comment-lines" };
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (std::find(std::begin(valueOptions), std::end(valueOptions), arg) != std::end(valueOptions) && i + 1 >= argc) {
+            return Usage(arg + " needs a value");
+        }
+        if (arg == "--seed") options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--faces") options.faces = ParseSize(argv[++i]);
+        else if (arg == "--vertices") options.vertices = ParseSize(argv[++i]);
+        else if (arg == "--size") options.bytes = ParseSize(argv[++i]);
+        else if (arg == "--grid") options.grid = static_cast<unsigned int>(std::max(2, std::min(4096, std::atoi(argv[++i]))));
+        else if (arg == "--quads") options.quadRatio = std::atof(argv[++i]);
+        else if (arg == "--ngons") options.ngonRatio = std::atof(argv[++i]);
+        else if (arg == "--max-sides") options.maxSides = static_cast<unsigned int>(std::max(5, std::min(32, std::atoi(argv[++i]))));
+        else if (arg == "--concave") options.concaveRatio = std::atof(argv[++i]);
+        else if (arg == "--no-uvs") options.uvs = false;
+        else if (arg == "--no-normals") options.normals = false;
+        else if (arg == "--negative") options.negativeRatio = std::atof(argv[++i]);
+        else if (arg == "--comments") options.commentRatio = std::atof(argv[++i]);
+        else if (arg == "--comment-lines") options.commentLines = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--crlf") options.crlf = true;
+        else if (arg == "--messy") options.messy = true;
+        else if (arg == "--check") options.check = true;
+        else if (arg.size() > 1 && arg[0] == '-') return Usage("unknown option " + arg);
+        else if (!options.path.empty()) return Usage("more than one output file");
+        else options.path = arg;
+    }
+    if (options.path.empty()) return Usage(std::string());
+    if (options.faces == 0 && options.vertices == 0 && options.bytes == 0) options.faces = 100000;
+
+    std::FILE* file = std::fopen(options.path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open file: " << options.path << "\n";
+        return 1;
+    }
+    Generator generator(options, file);
+    bool ok = generator.Run();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Error: Could not write file: " << options.path << "\n";
+        return 1;
+    }
+
+    const MeshChecksum checksum = generator.Checksum();
+    if (!WriteChecksum(ChecksumPath(options.path), checksum)) {
+        std::cerr << "Error: Could not write file: " << ChecksumPath(options.path) << "\n";
+        return 1;
+    }
+    std::cout << options.path << ": " << generator.Written() << " bytes, " << generator.PositionRecords() << " v, "
+        << generator.FaceRecords() << " f\n  " << ChecksumString(checksum) << "\n";
+
+    return options.check && Check(options.path, checksum) > 0 ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "mesh_cache.h"
+#include "texture_cache.h"
+
+// default size budget for a cache store directory
+constexpr uint64_t kDefaultCacheBudget = 1ull << 30;
+
+// what an entry holds, each kind has its own file extension
+enum class CacheKind {
+    Mesh,       // MeshCache, ".mesh"
+    Texture     // TextureCache, ".tex"
+};
+
+// where one source's cache lives in a store
+struct CacheEntry {
+    std::string sourcePath;
+    MeshCacheSource source{};   // stamp of the source as it is on disk now
+    std::string path;           // entry file for that content and build
+};
+
+struct CacheStoreStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;        // no entry, or a corrupt one that was dropped
+    uint64_t writes = 0;
+    uint64_t evictions = 0;
+    uint64_t evictedBytes = 0;
+};
+
+// content-addressed cache directory for meshes and cooked textures.
+//
+// entries are named by a hash of the source content, the loader options key
+// and the loader version, so identical sources share an entry and caches
+// never land next to the assets. a small ref per source path remembers the
+// last size, mtime and content hash seen there, so sources are only hashed
+// again when they were touched. entries are written to a temp file and
+// renamed into place, and the directory is trimmed to a size budget by
+// evicting the least recently used entries (hits bump the entry's mtime).
+// trimming also drops temp files left by crashed writers, entries' and
+// refs' alike, and the refs of sources that no longer exist.
+class CacheStore {
+public:
+    explicit CacheStore(std::string directory, uint64_t budgetBytes = kDefaultCacheBudget);
+
+    // process-wide store: $OBJLOADER_CACHE_DIR, else the per-user cache dir
+    static CacheStore& Default();
+
+    const std::string& Directory() const { return directory; }
+    uint64_t Budget() const { return budget; }
+    void SetBudget(uint64_t budgetBytes) { budget = budgetBytes; }
+
+    // stamp the source and pick its entry, false if the source can't be read
+    bool Resolve(const std::string& sourcePath, uint64_t optionsKey, uint32_t loaderVersion, CacheEntry& entry,
+        CacheKind kind = CacheKind::Mesh);
+
+    // open the entry into cache. counts a hit or a miss, and deletes entries
+    // that fail validation so they get rebuilt
+    CacheStatus Open(const CacheEntry& entry, MeshCache& cache);
+    CacheStatus Open(const CacheEntry& entry, TextureCache& cache);
+
+    // write the entry atomically, then evict down to the budget
+    bool Store(const CacheEntry& entry, const MeshView& mesh, MeshCacheEncoding encoding = MeshCacheEncoding::Raw);
+    bool Store(const CacheEntry& entry, const TextureImage& image);
+
+    // drop least recently used entries until the directory fits the budget,
+    // never the one named keep. returns bytes freed
+    uint64_t Evict(const std::string& keep = std::string());
+
+    CacheStoreStats Stats() const;
+
+private:
+    // ref file for a source's absolute path
+    std::string RefPath(const std::string& key) const;
+
+    template <typename Cache>
+    CacheStatus OpenEntry(const CacheEntry& entry, Cache& cache);
+
+    // write is called with the temp path to fill
+    template <typename Write>
+    bool StoreEntry(const CacheEntry& entry, Write write);
+
+    std::string directory;
+    std::atomic<uint64_t> budget;
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> misses{ 0 };
+    std::atomic<uint64_t> writes{ 0 };
+    std::atomic<uint64_t> evictions{ 0 };
+    std::atomic<uint64_t> evictedBytes{ 0 };
+};
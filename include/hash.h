@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// streaming 64-bit xxhash (XXH64), used to checksum cache files and
+// fingerprint source assets
+class Hash64 {
+public:
+    explicit Hash64(uint64_t seed = 0);
+
+    // feed more bytes, may be called any number of times
+    void Update(const void* data, size_t size);
+
+    // hash of everything fed so far, the state stays usable
+    uint64_t Digest() const;
+
+    // one-shot hash of a buffer
+    static uint64_t Of(const void* data, size_t size, uint64_t seed = 0);
+
+private:
+    uint64_t lanes[4];
+    uint64_t seed;
+    uint64_t totalSize = 0;
+    unsigned char buffer[32];
+    size_t buffered = 0;
+};
+
+// xxh64 of a whole file's contents, false if it can't be read
+bool HashFile(const std::string& path, uint64_t& hash);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// (position, uv, normal) index triple of an obj face corner, -1 when missing
+struct IndexTriple {
+    int position = -1;
+    int uv = -1;
+    int normal = -1;
+
+    bool operator==(const IndexTriple& other) const {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+};
+
+// flat open-addressing hash map from index triples to vertex ids.
+// linear probing over one contiguous slot array, no per-entry allocation.
+// ids are unsigned ints below 0xFFFFFFFF, which marks empty slots
+class IndexTripleMap {
+public:
+    IndexTripleMap() = default;
+
+    // size for expected entries up front so inserts never rehash
+    explicit IndexTripleMap(size_t expected) { Reserve(expected); }
+
+    void Reserve(size_t expected)
+    {
+        // keep the load factor at or below one half
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity *= 2;
+        if (capacity > slots.size()) Rehash(capacity);
+    }
+
+    void Clear()
+    {
+        for (Slot& slot : slots) slot.value = kEmpty;
+        count = 0;
+    }
+
+    size_t Size() const { return count; }
+    bool Empty() const { return count == 0; }
+
+    // return the id stored for key, or store value and return it; second is
+    // true when value was inserted. one probe sequence either way
+    std::pair<unsigned int, bool> Insert(const IndexTriple& key, unsigned int value)
+    {
+        if ((count + 1) * 2 > slots.size()) Rehash(slots.empty() ? 16 : slots.size() * 2);
+
+        size_t i = Hash(key) & mask;
+        while (true) {
+            Slot& slot = slots[i];
+            if (slot.value == kEmpty) {
+                slot.key = key;
+                slot.value = value;
+                ++count;
+                return { value, true };
+            }
+            if (slot.key == key) return { slot.value, false };
+            i = (i + 1) & mask;
+        }
+    }
+
+    // pointer to the stored id, or nullptr when key is absent
+    const unsigned int* Find(const IndexTriple& key) const
+    {
+        if (slots.empty()) return nullptr;
+
+        size_t i = Hash(key) & mask;
+        while (true) {
+            const Slot& slot = slots[i];
+            if (slot.value == kEmpty) return nullptr;
+            if (slot.key == key) return &slot.value;
+            i = (i + 1) & mask;
+        }
+    }
+
+private:
+    static constexpr unsigned int kEmpty = 0xFFFFFFFFu;
+
+    struct Slot {
+        IndexTriple key;
+        unsigned int value = kEmpty;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t count = 0;
+
+    // pack the triple into 64 bits and run the murmur3 finalizer over it
+    static size_t Hash(const IndexTriple& key)
+    {
+        uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(key.position)) << 32)
+            ^ (static_cast<uint64_t>(static_cast<uint32_t>(key.uv)) << 16)
+            ^ (static_cast<uint64_t>(static_cast<uint32_t>(key.normal)) * 0x9E3779B97F4A7C15ull);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    void Rehash(size_t capacity)
+    {
+        std::vector<Slot> old = std::move(slots);
+        slots.assign(capacity, Slot{});
+        mask = capacity - 1;
+        count = 0;
+        for (const Slot& slot : old) {
+            if (slot.value != kEmpty) Insert(slot.key, slot.value);
+        }
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <streambuf>
+
+enum class LogLevel : int {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off,
+};
+
+// messages below this level are compiled out, 0 keeps debug messages
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1
+#endif
+
+// one message as the sink sees it, text is not null terminated
+struct LogRecord {
+    LogLevel level;
+    const char* channel;
+    uint64_t timeNs;            // steady_clock
+    const char* text;
+    size_t length;
+};
+
+// diagnostics go into a fixed ring of message slots that any thread can
+// fill without locking, a background thread drains it into the sink. a
+// full ring drops debug and info messages (counted and reported later),
+// warnings and errors wait for room instead
+class Log {
+public:
+    // longer messages are cut short
+    static constexpr size_t kMessageSize = 512;
+    static constexpr size_t kQueueSize = 1024;
+
+    using Sink = std::function<void(const LogRecord&)>;
+
+    static bool Enabled(LogLevel level) { return level >= Level(); }
+    static LogLevel Level();
+    static void SetLevel(LogLevel level);
+
+    // replace the console output, null restores it. the sink runs on the
+    // log thread and must not log itself
+    static void SetSink(Sink sink);
+
+    // queue a message, channel must be a string literal
+    static void Write(LogLevel level, const char* channel, const char* text, size_t length);
+
+    // wait until every message queued so far has reached the sink
+    static void Flush();
+
+    // messages lost to a full queue since start
+    static uint64_t Dropped();
+};
+
+// formats one message into a stack buffer with ostream syntax and queues
+// it when it goes out of scope. used through the LOG_ macros below
+class LogLine {
+public:
+    LogLine(LogLevel level, const char* channel);
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    std::ostream& Stream() { return stream; }
+
+private:
+    class FixedBuffer : public std::streambuf {
+    public:
+        FixedBuffer(char* begin, size_t size) { setp(begin, begin + size); }
+        size_t Size() const { return static_cast<size_t>(pptr() - pbase()); }
+    };
+
+    LogLevel level;
+    const char* channel;
+    char text[Log::kMessageSize];
+    FixedBuffer buffer;
+    std::ostream stream;
+};
+
+// LOG_WARNING("loader", "Could not open " << path);
+#define LOG_AT(level, channel, message) \
+    do { \
+        if (static_cast<int>(level) >= LOG_MIN_LEVEL && Log::Enabled(level)) { \
+            LogLine logLine(level, channel); \
+            logLine.Stream() << message; \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(channel, message) LOG_AT(LogLevel::Debug, channel, message)
+#define LOG_INFO(channel, message) LOG_AT(LogLevel::Info, channel, message)
+#define LOG_WARNING(channel, message) LOG_AT(LogLevel::Warning, channel, message)
+#define LOG_ERROR(channel, message) LOG_AT(LogLevel::Error, channel, message)
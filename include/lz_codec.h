@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+// small lz77 block codec in the lz4 mould: byte-aligned sequences of
+// literals plus a 16-bit back reference, no entropy stage, so decoding is
+// mostly memcpy. one call handles one independent block
+
+// worst-case compressed size of a size-byte block
+size_t LzBound(size_t size);
+
+// compress size bytes into out, which must hold LzBound(size) bytes.
+// returns the compressed size
+size_t LzCompress(const void* in, size_t size, void* out);
+
+// decompress a block that must expand to exactly outSize bytes. false if
+// the stream is malformed, it never reads or writes outside the buffers
+bool LzDecompress(const void* in, size_t inSize, void* out, size_t outSize);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    // map file at path, check IsOpen() for success
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // map file at path, returns false if it can't be opened or mapped
+    bool Open(const std::string& path);
+
+    // unmap and close the file
+    void Close();
+
+    bool IsOpen() const { return opened; }
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+    std::string_view View() const { return std::string_view(data, size); }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
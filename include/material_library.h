@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+// reader for wavefront mtl material libraries, the files an obj names with
+// mtllib. only what the viewer can use is kept: newmtl, Ka, Kd, Ks, Ke, Ns,
+// d, Tr, map_Kd, map_Ks, map_Bump (or bump) and map_d. other statements are
+// skipped, so are map options like "-s 1 1 1", the file name is taken to be
+// the last field and resolved against the library's directory
+
+// stamp of the library as it is on disk now, size and time 0 if it is missing
+MaterialLibrary StampMaterialLibrary(const std::string& path);
+
+// append the materials the library defines, in file order. false if it
+// could not be read, materials is left as it was then
+bool ReadMaterialLibrary(const std::string& path, std::vector<MeshMaterial>& materials);
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mesh.h"
+#include "vertex_format.h"
+#include "mapped_file.h"
+
+// binary mesh cache container, the entry format of CacheStore
+//
+// layout: MeshCacheHeader, MeshCacheSection table, then the section payloads,
+// each starting on a 16-byte boundary. the checksum is xxh64 over the whole
+// file with the checksum field zeroed. readers reject anything whose magic,
+// version, byte order, layout, size or checksum does not match. the SRCE
+// section records what the cache was built from. the mesh is stored either
+// raw (VERT/INDX, usable in place) or packed (VRTZ/IDXZ, see mesh_codec.h).
+// meshes with levels of detail add a LODS table of MeshLod ranges into the
+// index buffer, and meshes split into clusters a MLET table of Meshlet
+// records, both stored as is in either encoding. compact vertex layouts
+// (vertex_format.h) are described by the header's attribute formats and
+// carry their VertexQuantization in a QUNT section. indices are 32-bit, or
+// 16-bit (header indexSize 2) when the mesh has at most
+// kMaxShortIndexVertices vertices. meshes with materials add a SUBM table
+// of MeshSubmesh ranges and a MATL section with the materials and the
+// stamps of the mtl libraries they came from: counts, then each library
+// (size, time, path) and each material (its 14 floats, then name and the
+// four map paths), strings as a uint32 length and the bytes.
+
+constexpr uint32_t kMeshCacheVersion = 3;
+constexpr uint32_t kMeshCacheEndianTag = 0x01020304u;
+
+constexpr uint32_t MakeSectionId(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(static_cast<unsigned char>(a))
+        | (static_cast<uint32_t>(static_cast<unsigned char>(b)) << 8)
+        | (static_cast<uint32_t>(static_cast<unsigned char>(c)) << 16)
+        | (static_cast<uint32_t>(static_cast<unsigned char>(d)) << 24);
+}
+
+constexpr uint32_t kSectionVertices = MakeSectionId('V', 'E', 'R', 'T');
+constexpr uint32_t kSectionIndices = MakeSectionId('I', 'N', 'D', 'X');
+constexpr uint32_t kSectionSource = MakeSectionId('S', 'R', 'C', 'E');
+constexpr uint32_t kSectionPackedVertices = MakeSectionId('V', 'R', 'T', 'Z');
+constexpr uint32_t kSectionPackedIndices = MakeSectionId('I', 'D', 'X', 'Z');
+constexpr uint32_t kSectionLods = MakeSectionId('L', 'O', 'D', 'S');
+constexpr uint32_t kSectionMeshlets = MakeSectionId('M', 'L', 'E', 'T');
+constexpr uint32_t kSectionQuantization = MakeSectionId('Q', 'U', 'N', 'T');
+constexpr uint32_t kSectionSubmeshes = MakeSectionId('S', 'U', 'B', 'M');
+constexpr uint32_t kSectionMaterials = MakeSectionId('M', 'A', 'T', 'L');
+
+// how the mesh sections of a cache are stored
+enum class MeshCacheEncoding {
+    Raw,        // plain arrays, mapped straight into the renderer
+    Packed      // filtered and lz compressed, smaller but decoded on load
+};
+
+struct MeshCacheHeader {
+    char magic[8];              // "OBJMESH" + 0x1A
+    uint32_t version;
+    uint32_t endianTag;         // kMeshCacheEndianTag in the writer's byte order
+    uint32_t headerSize;        // sizeof(MeshCacheHeader)
+    uint32_t sectionCount;
+    uint64_t fileSize;          // total file length in bytes
+    uint64_t checksum;          // xxh64 of the file with this field zeroed
+
+    // vertex layout descriptor
+    AttributeFormat positionFormat;
+    AttributeFormat uvFormat;
+    AttributeFormat normalFormat;
+    uint8_t indexSize;          // bytes per index
+    uint32_t vertexStride;      // bytes per vertex
+    uint64_t vertexCount;
+    uint64_t indexCount;
+};
+static_assert(sizeof(MeshCacheHeader) == 64, "cache header layout must not change silently");
+
+struct MeshCacheSection {
+    uint32_t id;                // MakeSectionId fourcc
+    uint32_t reserved;
+    uint64_t offset;            // from the start of the file
+    uint64_t size;              // payload bytes
+};
+static_assert(sizeof(MeshCacheSection) == 24, "cache section layout must not change silently");
+
+// what a cache was built from, checked before the cache is trusted
+struct MeshCacheSource {
+    uint64_t size;              // source file length
+    int64_t modifiedTime;       // source last write time, filesystem clock ticks
+    uint64_t contentHash;       // xxh64 of the source file
+    uint64_t optionsKey;        // Loader::OptionsKey() of the build
+    uint32_t loaderVersion;     // kLoaderVersion of the build
+    uint32_t reserved;
+};
+static_assert(sizeof(MeshCacheSource) == 40, "cache source layout must not change silently");
+
+enum class CacheStatus {
+    Ok,
+    Missing,    // no cache file
+    Invalid     // present but stale or corrupt, see MeshCache::Error()
+};
+
+// validated read-only view of a cache file
+class MeshCache {
+public:
+    // map and validate the cache at path. a raw cache whose indices go past
+    // its vertices is Invalid, packed ones are checked by Read
+    CacheStatus Open(const std::string& path);
+
+    // why Open returned Invalid
+    const std::string& Error() const { return error; }
+
+    const MeshCacheHeader& Header() const { return header; }
+    const MeshCacheSource& Source() const { return source; }
+
+    // payload of a section, nullptr when the file has no such section
+    const void* Section(uint32_t id, uint64_t* size = nullptr) const;
+
+    MeshCacheEncoding Encoding() const { return encoding; }
+
+    // vertex layout the cache was written with
+    const VertexLayout& Layout() const { return layout; }
+
+    // materials and the libraries they were read from, decoded by Open
+    const std::vector<MeshMaterial>& Materials() const { return materials; }
+    const std::vector<MaterialLibrary>& MaterialLibraries() const { return materialLibraries; }
+
+    // the mesh in place inside the mapping, valid while this cache is open.
+    // empty for packed caches, those have to be Read
+    MeshView View() const;
+
+    // copy or decode the mesh out of the mapping. Invalid, with the cache
+    // closed, if a packed stream turns out to be malformed or one of its
+    // indices is out of range for the vertices
+    CacheStatus Read(Mesh& mesh);
+
+    // write a cache file for the mesh, false if it could not be written
+    static bool Write(const std::string& path, const MeshCacheSource& source, const MeshView& mesh,
+        MeshCacheEncoding encoding = MeshCacheEncoding::Raw);
+
+private:
+    CacheStatus Reject(const std::string& reason);
+
+    MappedFile file;
+    MeshCacheHeader header{};
+    MeshCacheSource source{};
+    MeshCacheEncoding encoding = MeshCacheEncoding::Raw;
+    VertexLayout layout;
+    std::vector<MeshMaterial> materials;
+    std::vector<MaterialLibrary> materialLibraries;
+    std::vector<MeshCacheSection> sections;
+    std::string error;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vertex.h"
+
+// compressed encoding of the mesh streams in a cache file.
+//
+// vertices are transposed from 32-byte Vertex records into 32 byte planes
+// (byte 0 of every position.x, then byte 1, ...; compact layouts get one
+// plane per byte of their stride), which de-interleaves the
+// fields and shuffles the float bytes in one pass: sign/exponent bytes and
+// neighbouring values line up and compress well. indices are delta coded
+// against the previous index, zigzagged so small steps either way stay
+// small, then shuffled into one plane per index byte the same way (2 for
+// 16-bit indices, 4 for 32-bit). the filtered stream is cut into
+// independent blocks and each block goes through LzCompress.
+//
+// a packed stream is a PackedStreamHeader, blockCount uint32 compressed
+// block sizes, then the blocks back to back. blocks lz could not shrink are
+// stored raw, flagged by the top bit of their size.
+
+// transform applied before compression
+enum class StreamFilter : uint32_t {
+    None = 0,
+    VertexPlanes = 1,   // vertex records to byte planes
+    IndexDelta = 2      // zigzag deltas to byte planes
+};
+
+struct PackedStreamHeader {
+    uint64_t rawSize;           // bytes once decoded
+    StreamFilter filter;
+    uint32_t blockSize;         // raw bytes per block, the last may be short
+    uint32_t blockCount;
+    uint32_t reserved;
+};
+static_assert(sizeof(PackedStreamHeader) == 24, "packed stream layout must not change silently");
+
+std::vector<unsigned char> PackVertices(const Vertex* vertices, size_t count);
+
+// any stride-byte vertex records, e.g. a compact layout from vertex_format.h
+std::vector<unsigned char> PackVertices(const void* vertices, size_t count, size_t stride);
+std::vector<unsigned char> PackIndices(const unsigned short* indices, size_t count);
+std::vector<unsigned char> PackIndices(const unsigned int* indices, size_t count);
+
+// decode into out, which holds count elements. false if the stream is
+// malformed or does not decode to exactly count elements
+bool UnpackVertices(const void* packed, size_t size, Vertex* out, size_t count);
+bool UnpackVertices(const void* packed, size_t size, void* out, size_t count, size_t stride);
+bool UnpackIndices(const void* packed, size_t size, unsigned short* out, size_t count);
+bool UnpackIndices(const void* packed, size_t size, unsigned int* out, size_t count);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "loader.h"
+#include "thread_pool.h"
+
+// runs Loader::GetVertices on a worker thread. the render thread polls for
+// a finished load each frame and does only the gpu upload itself, so the
+// current mesh keeps drawing while the next one is parsed
+class MeshLoadService {
+public:
+    MeshLoadService();
+    ~MeshLoadService();
+
+    MeshLoadService(const MeshLoadService&) = delete;
+    MeshLoadService& operator=(const MeshLoadService&) = delete;
+
+    // start loading path, cancelling any load still in flight
+    void Request(const std::string& path);
+
+    // stop the load in flight, it finishes early and is discarded
+    void Cancel();
+
+    // a load is queued or running
+    bool Busy() const { return current != nullptr; }
+
+    // path and progress of the load in flight
+    const std::string& PendingPath() const;
+    float Progress() const;
+
+    // hand over a finished load. false while nothing new is ready; on true
+    // loader holds the mesh (see Loader::Mesh) until it is released
+    bool Poll(std::string& path, std::unique_ptr<Loader>& loader);
+
+    // applied to the next Request, turns on all of Loader's optimizer passes
+    bool optimizeMeshes = true;
+
+    // levels of detail the next Request builds, 1 for the full mesh only
+    unsigned int lodCount = 4;
+
+    // split meshes into clusters the renderer culls one by one
+    bool buildMeshlets = true;
+
+    // build and cache kCompactVertexFormat vertices instead of floats
+    bool compactVertices = true;
+
+    // 16-bit indices for meshes small enough to use them
+    bool narrowIndices = true;
+
+private:
+    struct Job {
+        std::string path;
+        std::unique_ptr<Loader> loader;
+        LoadProgress progress;
+        std::future<void> done;
+    };
+
+    // cancelled jobs still running, kept alive until their worker lets go
+    void Reap();
+
+    std::unique_ptr<Job> current;
+    std::vector<std::unique_ptr<Job>> retired;
+
+    // last member, so the worker is joined before the jobs it uses go away
+    ThreadPool pool;
+};
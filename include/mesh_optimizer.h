@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+
+// post-parse mesh passes. each reorders data the loader produced without
+// changing what is drawn, and can be measured without a gpu through the
+// matching Analyze function. index arguments are unsigned short or
+// unsigned int, both instantiated in mesh_optimizer.cpp.
+
+// fifo size the analyzer assumes, close to what current gpus reuse
+constexpr unsigned int kDefaultVertexCacheSize = 16;
+
+struct VertexCacheStats {
+    size_t vertexTransforms = 0;    // cache misses, i.e. vertex shader runs
+    size_t triangles = 0;
+    size_t vertices = 0;
+    float acmr = 0.0f;              // transforms per triangle, 0.5 is ideal
+    float atvr = 0.0f;              // transforms per vertex, 1.0 is ideal
+};
+
+// simulate a fifo post-transform cache over a triangle list
+template <typename Index>
+VertexCacheStats AnalyzeVertexCache(const Index* indices, size_t indexCount, size_t vertexCount,
+    unsigned int cacheSize = kDefaultVertexCacheSize);
+
+// reorder triangles for post-transform cache hits (forsyth's linear-speed
+// vertex cache optimisation). destination may be indices itself
+template <typename Index>
+void OptimizeVertexCache(Index* destination, const Index* indices, size_t indexCount, size_t vertexCount);
+
+// bytes per line in the vertex fetch simulation, and lines it keeps
+constexpr unsigned int kFetchLineSize = 64;
+constexpr unsigned int kFetchCacheLines = 128;
+
+struct VertexFetchStats {
+    size_t bytesFetched = 0;        // cache line traffic for the vertex loads
+    float overfetch = 0.0f;         // bytesFetched over the vertex buffer size, 1.0 is ideal
+};
+
+// simulate vertex loads (after the post-transform cache) through a small
+// fifo cache of kFetchLineSize-byte lines
+template <typename Index>
+VertexFetchStats AnalyzeVertexFetch(const Index* indices, size_t indexCount, size_t vertexCount,
+    size_t vertexSize);
+
+// reorder vertices to first use in the index stream and remap indices to
+// match. vertices no index uses are dropped. destination must not alias
+// vertices, indices are rewritten in place. returns the new vertex count
+template <typename Index>
+size_t OptimizeVertexFetch(void* destination, Index* indices, size_t indexCount,
+    const void* vertices, size_t vertexCount, size_t vertexSize);
+
+struct OverdrawStats {
+    size_t pixelsCovered = 0;       // pixels with at least one fragment
+    size_t pixelsShaded = 0;        // fragments that passed the depth test
+    float overdraw = 0.0f;          // shaded over covered, 1.0 is ideal
+};
+
+// rasterise the mesh with a depth test from the six axis directions on a
+// small cpu grid and count fragments that get shaded. back faces are culled,
+// counter-clockwise ones are in front as in gl. positions points at the
+// first vertex's xyz floats, stride is bytes between vertices
+template <typename Index>
+OverdrawStats AnalyzeOverdraw(const Index* indices, size_t indexCount, const float* positions,
+    size_t vertexCount, size_t stride);
+
+// split a vertex-cache-optimised index buffer into clusters at cache
+// boundaries and draw the clusters that are likely to occlude others first
+// (sander et al., view-independent sort by how far a cluster faces out
+// from the mesh centre). threshold caps how much worse than its hard
+// cluster's own acmr a split may make the acmr of the part, e.g. 1.05
+template <typename Index>
+void OptimizeOverdraw(Index* destination, const Index* indices, size_t indexCount,
+    const float* positions, size_t vertexCount, size_t stride, float threshold = 1.05f);
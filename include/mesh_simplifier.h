@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include "vertex.h"
+
+// quadric error metric simplification (garland and heckbert) by edge
+// collapse onto existing vertices, so uvs and normals are never
+// interpolated and the vertex buffer is shared by every level of detail.
+//
+// collapses work on positions. the loader's (pos, uv, normal) dedup leaves
+// several vertices on one position where attributes differ, and a collapse
+// moves all of them together, each onto the vertex across the same edge;
+// where no such vertex exists (collapsing across a uv seam or hard edge)
+// the collapse is refused. open borders only collapse along themselves,
+// border and seam edges add perpendicular planes to the quadrics so their
+// shape holds, and collapses that fold a triangle over or turn a vertex's
+// normal too far are rejected. indices are unsigned short or unsigned int.
+
+// simplify to at most targetIndexCount indices, stopping early once the
+// next collapse would move the surface more than targetError (object-space
+// units). writes the new index list to destination, which needs room for
+// indexCount indices and may alias indices, and returns its length.
+// resultError, when given, receives the largest error introduced
+template <typename Index>
+size_t SimplifyMesh(Index* destination, const Index* indices, size_t indexCount,
+    const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError,
+    float* resultError = nullptr);
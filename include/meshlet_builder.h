@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "mesh.h"
+
+// splits a triangle list into meshlets for cluster culling. each meshlet is
+// a contiguous run of triangles, so a visible subset can be drawn with one
+// glMultiDrawElements call over the unchanged index buffer.
+//
+// the normal cone bounds the directions its triangles face: when
+// dot(normalize(coneApex - eye), coneAxis) >= coneCutoff every triangle is
+// back-facing from eye. meshlets whose normals spread too far get a cutoff
+// above 1 and are never cone culled. indices are unsigned short or
+// unsigned int
+
+constexpr size_t kMaxMeshletVertices = 64;
+constexpr size_t kMaxMeshletTriangles = 124;
+
+// grow meshlets from triangles sharing a corner position, so flat shaded
+// faces with their own vertices still cluster, preferring those that add
+// the fewest new vertices, in the order of the input otherwise. writes the
+// reordered triangles to destination, which may alias indices, and returns
+// the meshlets with indexOffset relative to destination. positions points
+// at the first vertex's xyz floats, stride is bytes between vertices
+template <typename Index>
+std::vector<Meshlet> BuildMeshlets(Index* destination, const Index* indices, size_t indexCount,
+    const float* positions, size_t vertexCount, size_t stride,
+    size_t maxVertices = kMaxMeshletVertices, size_t maxTriangles = kMaxMeshletTriangles);
+
+// bounding sphere and normal cone of a run of triangles
+template <typename Index>
+void ComputeMeshletBounds(Meshlet& meshlet, const Index* indices, const float* positions, size_t stride);
@@ -0,0 +1,27 @@
+#pragma once
+
+// locale-independent number parsing for obj attributes and face indices
+
+// why a number could not be parsed
+enum class NumberError {
+    None,
+    Invalid,    // no digits where a number was expected
+    OutOfRange  // value does not fit the target type
+};
+
+// ptr points one past the last consumed character on success, at first otherwise
+struct NumberResult {
+    const char* ptr;
+    NumberError error;
+};
+
+// parse a decimal float ([+-]digits[.digits][(e|E)[+-]digits]) from [first, last).
+// results are correctly rounded, so printed floats round-trip bit exactly.
+// leading whitespace is not skipped, hex, inf and nan are rejected
+NumberResult ParseFloat(const char* first, const char* last, float& value);
+
+// parse a decimal int ([+-]digits) from [first, last)
+NumberResult ParseInt(const char* first, const char* last, int& value);
+
+// readable name for error reporting
+const char* NumberErrorString(NumberError error);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// polygons up to this many corners triangulate out of fixed stack buffers,
+// larger ones use the scratch vectors
+constexpr size_t kFixedPolygonCorners = 16;
+
+// reused between calls so large polygons only allocate while it grows
+struct PolygonScratch {
+    struct Point {
+        double x, y;
+    };
+    std::vector<Point> points;
+    std::vector<uint32_t> ring;
+};
+
+// ear clipping of a simple polygon given by its 3d corners in order. the
+// corners are projected onto the plane of the polygon's newell normal and
+// ears are cut starting at corner 1, moving on to the corner after each
+// cut, so a convex polygon comes out as the fan (0, i, i + 1) and keeps its
+// winding. where no ear is left (self-intersecting or degenerate input)
+// the next corner is cut regardless, so there are always count - 2
+// triangles. writes them to triangles as corner indices, 3 * (count - 2)
+// entries, and returns the triangle count, 0 for fewer than 3 corners
+size_t TriangulatePolygon(const glm::vec3* corners, size_t count, uint32_t* triangles, PolygonScratch& scratch);
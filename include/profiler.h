@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_TSC 1
+#else
+#include <chrono>
+#define PROFILER_TSC 0
+#endif
+
+// build with PROFILER_ENABLED=0 to compile every zone out, the calls below
+// then do nothing and PROFILE_ZONE expands to nothing
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// scoped-zone profiler. each thread records finished zones into a ring
+// buffer of its own, so recording takes no lock and costs two clock reads.
+// nothing is recorded until Start, and WriteChromeTrace turns what the
+// buffers hold into json for chrome://tracing or ui.perfetto.dev.
+// zone names must outlive the capture, string literals in practice
+class Profiler {
+public:
+    // zones each thread keeps, older ones are overwritten
+    static constexpr size_t kZonesPerThread = 1 << 15;
+
+    static void Start();
+    static void Stop();
+    static bool Recording()
+    {
+#if PROFILER_ENABLED
+        return recording.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+    // clock ticks: the tsc where there is one, steady_clock nanoseconds otherwise
+    static uint64_t Now()
+    {
+#if PROFILER_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // add a finished zone to the calling thread's buffer
+    static void Record(const char* name, uint64_t begin, uint64_t end);
+
+    // label the calling thread in the trace, name must outlive it as well
+    static void NameThread(const char* name);
+
+    // every buffered zone as a chrome trace, false if path can't be written
+    static bool WriteChromeTrace(const std::string& path);
+
+    // drop buffered zones of all threads
+    static void Clear();
+
+private:
+#if PROFILER_ENABLED
+    static std::atomic<bool> recording;
+#endif
+};
+
+// records the enclosing scope, if a capture is running when it opens
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : name(name), begin(Profiler::Recording() ? Profiler::Now() : 0)
+    {
+    }
+    ~ProfileZone()
+    {
+        if (begin != 0) Profiler::Record(name, begin, Profiler::Now());
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t begin;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
@@ -23,6 +23,12 @@ public:
     // set a vec3 uniform by name
     void setVec3(const std::string& name, const glm::vec3& value) const;
 
+    // set a vec2 uniform by name
+    void setVec2(const std::string& name, const glm::vec2& value) const;
+
+    // set a bool uniform by name
+    void setBool(const std::string& name, bool value) const;
+
 private:
     // helper to get uniform location
     int getUniformLocation(const std::string& name) const;
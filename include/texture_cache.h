@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mesh_cache.h"
+#include "texture_codec.h"
+
+// cooked texture cache file, the texture entry format of CacheStore
+//
+// layout: TextureCacheHeader, one TextureCacheLevel per mip, then the level
+// payloads, each on a 16-byte boundary and already in the block layout gl
+// takes, so a level uploads straight from the mapping. validated the same
+// way as mesh caches: magic, version, byte order, size and an xxh64
+// checksum over the file with the checksum field zeroed.
+
+constexpr uint32_t kTextureCacheVersion = 1;
+
+struct TextureCacheHeader {
+    char magic[8];              // "OBJTEXC" + 0x1A
+    uint32_t version;
+    uint32_t endianTag;         // kMeshCacheEndianTag in the writer's byte order
+    uint32_t headerSize;        // sizeof(TextureCacheHeader)
+    uint32_t levelCount;
+    uint64_t fileSize;
+    uint64_t checksum;          // xxh64 of the file with this field zeroed
+    TextureFormat format;
+    uint32_t width;             // of level 0
+    uint32_t height;
+    uint32_t reserved;
+    MeshCacheSource source;     // what the texture was cooked from
+};
+static_assert(sizeof(TextureCacheHeader) == 96, "texture cache header layout must not change silently");
+
+struct TextureCacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;            // from the start of the file
+    uint64_t size;              // payload bytes, LevelSize of the level
+};
+static_assert(sizeof(TextureCacheLevel) == 24, "texture cache level layout must not change silently");
+
+// validated read-only view of a texture cache file
+class TextureCache {
+public:
+    CacheStatus Open(const std::string& path);
+
+    const std::string& Error() const { return error; }
+
+    const TextureCacheHeader& Header() const { return header; }
+    const MeshCacheSource& Source() const { return header.source; }
+    TextureFormat Format() const { return header.format; }
+
+    size_t LevelCount() const { return levels.size(); }
+    const TextureCacheLevel& Level(size_t index) const { return levels[index]; }
+
+    // level payload inside the mapping, valid while this cache is open
+    const unsigned char* LevelData(size_t index) const;
+
+    // copy the whole chain out of the mapping
+    bool Read(TextureImage& image) const;
+
+    static bool Write(const std::string& path, const MeshCacheSource& source, const TextureImage& image);
+
+private:
+    CacheStatus Reject(const std::string& reason);
+
+    MappedFile file;
+    TextureCacheHeader header{};
+    std::vector<TextureCacheLevel> levels;
+    std::string error;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// cpu side texture cooking: mip chains and bc block compression.
+//
+// mips are filtered in linear light. texels are taken as srgb, decoded
+// through a table, box filtered four at a time with sse2 and encoded back,
+// so dark and bright areas keep their weight in small mips. alpha is
+// filtered as is. the bc encoders fit each 4x4 block along its principal
+// axis and give every texel the nearest palette entry: bc1 for opaque
+// colour, bc3 adds an interpolated alpha block, bc7 uses mode 6 (one
+// subset, rgba 7.7.7.7 with p-bits, 4-bit indices) for higher quality at
+// bc3's size. level data is laid out exactly as glCompressedTexImage2D
+// expects it.
+
+// bump when filtering or encoding changes, so cooked caches are rebuilt
+constexpr uint32_t kTextureCookVersion = 2;
+
+// how the levels of a TextureImage are stored, persisted in texture caches
+enum class TextureFormat : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1,    // 8 bytes per 4x4 block, no alpha
+    BC3 = 2,    // 16 bytes per block, bc1 colour plus interpolated alpha
+    BC7 = 3     // 16 bytes per block
+};
+
+// one level of a mip chain: rgba8 texels, or bc blocks in row order
+struct MipLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// a full mip chain, level 0 first
+struct TextureImage {
+    TextureFormat format = TextureFormat::RGBA8;
+    std::vector<MipLevel> levels;
+};
+
+// texels per block side (1 for rgba8) and bytes per block
+int BlockDimension(TextureFormat format);
+size_t BlockBytes(TextureFormat format);
+
+// bytes in one row of blocks, how many such rows, and the whole level
+size_t LevelRowBytes(TextureFormat format, int width);
+int LevelRowCount(TextureFormat format, int height);
+size_t LevelSize(TextureFormat format, int width, int height);
+
+// any texel with alpha below 255
+bool HasAlpha(const unsigned char* rgba, int width, int height);
+
+// rgba8 chain from level 0 down to 1x1, filtered in linear light
+void BuildMipChain(const unsigned char* rgba, int width, int height, std::vector<MipLevel>& levels);
+
+// encode an rgba8 level into format. pool, when given, splits the block rows
+MipLevel EncodeLevel(const MipLevel& level, TextureFormat format, ThreadPool* pool = nullptr);
+
+// mip chain plus encoding in one go. BC1 becomes BC3 when the image has alpha
+TextureImage CookTexture(const unsigned char* rgba, int width, int height, TextureFormat format,
+    ThreadPool* pool = nullptr);
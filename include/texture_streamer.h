@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "texture_codec.h"
+#include "thread_pool.h"
+
+// default bytes of texel data pushed to the gpu per frame
+constexpr size_t kDefaultTextureBudget = 1 << 20;
+
+// cooked texture ready for upload, no levels if it could not be loaded
+struct DecodedTexture {
+    std::string path;
+    TextureImage image;
+    bool fromCache = false;
+};
+
+// loads textures on a worker thread and streams them to the gpu a few rows
+// at a time through a pixel buffer object, at most frameBudget bytes per
+// frame. the worker takes the cooked chain from the cache store when it
+// has one, else decodes the jpeg/png, builds mips and block compresses
+// them (see texture_codec.h) and stores the result. a small placeholder
+// made from a low mip is shown until the whole chain has landed. several
+// textures, one per material, load and stream one after the other. all
+// methods but the constructor belong to the render thread
+class TextureStreamer {
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // start decoding paths in order, dropping anything still decoding or
+    // streaming. texture i keeps showing what it showed before until the
+    // new path i has a placeholder, those beyond the new count are deleted
+    void Request(const std::vector<std::string>& paths);
+    void Request(const std::string& path) { Request(std::vector<std::string>{ path }); }
+
+    // once per frame: pick up finished decodes and upload up to frameBudget bytes
+    void Update();
+
+    // texture to sample now for requested path index: the full one when
+    // complete, else the placeholder, else 0
+    unsigned int Texture(size_t index = 0) const;
+
+    // uploads are still in progress, and how far along they are over all
+    // requested paths
+    bool Streaming() const { return !decoding.empty() || stream != nullptr; }
+    float Progress() const;
+
+    // delete all gl objects, needs the context still current
+    void Release();
+
+    // bytes of texel data uploaded per frame
+    size_t frameBudget = kDefaultTextureBudget;
+
+    // format to cook to. falls back to RGBA8 when the driver lacks it
+    TextureFormat format = TextureFormat::BC1;
+
+    // read and write cooked textures in the default cache store
+    bool useCache = true;
+
+private:
+    // what one requested path shows
+    struct Slot {
+        unsigned int texture = 0;       // complete texture on screen
+        unsigned int placeholder = 0;
+    };
+
+    // a decode on the worker and the slot it is for
+    struct Decode {
+        size_t slot;
+        std::future<std::unique_ptr<DecodedTexture>> image;
+    };
+
+    // a texture whose levels are being filled
+    struct Stream {
+        std::unique_ptr<DecodedTexture> image;
+        size_t slot = 0;
+        unsigned int texture = 0;
+        size_t level = 0;       // counts down from the smallest mip to 0
+        int row = 0;            // next row of blocks in that level
+        size_t bytesDone = 0;
+        size_t bytesTotal = 0;
+    };
+
+    void Begin(size_t slot, std::unique_ptr<DecodedTexture> image);
+    void Finish();
+
+    std::deque<Decode> decoding;    // in request order
+    std::shared_ptr<std::atomic<bool>> abandoned;   // set for the decodes of older requests
+    std::unique_ptr<Stream> stream;
+    std::vector<Slot> slots;
+    size_t finished = 0;            // slots of the last request done with
+    unsigned int pbo = 0;
+
+    // last member, so the worker is joined before the rest goes away
+    ThreadPool pool;
+};
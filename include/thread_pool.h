@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads draining a shared task queue
+class ThreadPool {
+public:
+    // threadCount 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int Size() const { return static_cast<unsigned int>(workers.size()); }
+
+    // queue a task, the returned future carries its result
+    template <typename F>
+    auto Submit(F&& task) -> std::future<decltype(task())>
+    {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        condition.notify_one();
+        return future;
+    }
+
+    // run body(i) for every i in [0, count) on the pool and wait for all of them
+    template <typename F>
+    void ParallelFor(size_t count, F&& body)
+    {
+        std::vector<std::future<void>> pending;
+        pending.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            pending.push_back(Submit([&body, i]() { body(i); }));
+        }
+        for (auto& f : pending) f.get();
+    }
+
+    // resolve a thread count setting, 0 meaning one per hardware thread
+    static unsigned int ResolveThreadCount(unsigned int requested);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
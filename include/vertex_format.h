@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vertex.h"
+
+// compact vertex layouts chosen when a mesh is built and stored in the
+// cache, so the gpu and the mapped cache hold the same narrow records.
+//
+// positions are unorm16 across the mesh bounds, uvs half floats or unorm16
+// across the uv bounds, normals octahedral in two snorm8 or snorm16
+// components. attributes keep the order position, uv, normal, each aligned
+// to its component size, with the stride rounded up to 4 bytes. the float
+// layout is exactly Vertex. the vertex shader expands positions and unorm
+// uvs with VertexQuantization and decodes octahedral normals.
+
+// per-attribute storage format, also the vertex layout descriptor in the
+// mesh cache header
+enum class AttributeFormat : uint8_t {
+    None = 0,
+    Float2 = 1,
+    Float3 = 2,
+    Unorm16x3 = 3,      // position across the mesh bounds
+    Half2 = 4,          // uv
+    Unorm16x2 = 5,      // uv across the uv bounds
+    Oct8 = 6,           // normal, octahedral snorm8x2
+    Oct16 = 7           // normal, octahedral snorm16x2
+};
+
+struct VertexFormat {
+    AttributeFormat position = AttributeFormat::Float3;
+    AttributeFormat uv = AttributeFormat::Float2;
+    AttributeFormat normal = AttributeFormat::Float3;
+
+    bool operator==(const VertexFormat& other) const
+    {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+    bool operator!=(const VertexFormat& other) const { return !(*this == other); }
+
+    // the plain Vertex layout
+    bool IsFloat() const { return *this == VertexFormat(); }
+};
+
+// unorm16 positions and half uvs with 8-bit octahedral normals, 12 bytes
+constexpr VertexFormat kCompactVertexFormat = { AttributeFormat::Unorm16x3, AttributeFormat::Half2, AttributeFormat::Oct8 };
+
+// value = offset + stored * scale for the unorm attributes, identity otherwise
+struct VertexQuantization {
+    glm::vec3 positionOffset{0.0f};
+    glm::vec3 positionScale{1.0f};
+    glm::vec2 uvOffset{0.0f};
+    glm::vec2 uvScale{1.0f};
+};
+static_assert(sizeof(VertexQuantization) == 40, "quantization ranges are stored in the cache");
+
+// where the attributes of a format sit and how to expand them
+struct VertexLayout {
+    VertexFormat format;
+    uint32_t stride = sizeof(Vertex);
+    uint32_t positionOffset = 0;
+    uint32_t uvOffset = 12;
+    uint32_t normalOffset = 20;
+    VertexQuantization quantization;
+};
+
+// every attribute is one this build can store for its slot
+bool IsValidVertexFormat(const VertexFormat& format);
+
+// offsets and stride of a format, with identity quantization
+VertexLayout MakeVertexLayout(const VertexFormat& format);
+
+// bytes one attribute of the format takes
+size_t AttributeSize(AttributeFormat format);
+
+// encode vertices into layout.stride-byte records. fills layout's
+// quantization with the ranges the encoding used
+std::vector<unsigned char> QuantizeVertices(const Vertex* vertices, size_t count, VertexLayout& layout);
+
+// expand one record back to floats, for checks and tools
+Vertex DequantizeVertex(const unsigned char* record, const VertexLayout& layout);
+
+// ieee half conversions, round to nearest even
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
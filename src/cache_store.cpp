@@ -0,0 +1,358 @@
+#include "../include/cache_store.h"
+#include "../include/hash.h"
+#include "../include/log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr const char* kMeshExtension = ".mesh";
+    constexpr const char* kTextureExtension = ".tex";
+    constexpr const char* kRefExtension = ".ref";
+    constexpr const char* kTempMarker = ".tmp";
+
+    // temp files this old are left over from a crashed writer
+    constexpr auto kStaleTempAge = std::chrono::hours(1);
+
+    std::string GetEnv(const char* name)
+    {
+#ifdef _WIN32
+        char* value = nullptr;
+        size_t length = 0;
+        if (_dupenv_s(&value, &length, name) != 0 || !value) return std::string();
+        std::string result(value);
+        std::free(value);
+        return result;
+#else
+        const char* value = std::getenv(name);
+        return value ? std::string(value) : std::string();
+#endif
+    }
+
+    std::string DefaultDirectory()
+    {
+        std::string dir = GetEnv("OBJLOADER_CACHE_DIR");
+        if (!dir.empty()) return dir;
+#ifdef _WIN32
+        std::string base = GetEnv("LOCALAPPDATA");
+        if (!base.empty()) return (fs::path(base) / "OBJLoader" / "cache").string();
+#else
+        std::string base = GetEnv("XDG_CACHE_HOME");
+        if (!base.empty()) return (fs::path(base) / "objloader").string();
+        base = GetEnv("HOME");
+        if (!base.empty()) return (fs::path(base) / ".cache" / "objloader").string();
+#endif
+        std::error_code ec;
+        return (fs::temp_directory_path(ec) / "objloader-cache").string();
+    }
+
+    std::string Hex(uint64_t value)
+    {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    // unique sibling of path to write into before renaming over it
+    std::string TempPath(const std::string& path)
+    {
+        static std::atomic<uint64_t> counter{ 0 };
+        Hash64 hash;
+        const uint64_t parts[3] = {
+            static_cast<uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id())),
+            static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()),
+            counter++
+        };
+        hash.Update(parts, sizeof(parts));
+        return path + kTempMarker + Hex(hash.Digest()).substr(0, 8);
+    }
+
+    // rename temp over path, or clean it up
+    bool Commit(const std::string& temp, const std::string& path)
+    {
+        std::error_code ec;
+        fs::rename(temp, path, ec);
+        if (!ec) return true;
+        fs::remove(temp, ec);
+        return false;
+    }
+
+    // absolute source path, what refs are named and keyed by
+    std::string RefKey(const std::string& sourcePath)
+    {
+        std::error_code ec;
+        fs::path absolute = fs::weakly_canonical(sourcePath, ec);
+        return ec ? sourcePath : absolute.string();
+    }
+
+    // a ref is the source stamp followed by the source key, so refs of
+    // deleted sources can be found and dropped
+    bool ReadRef(const std::string& path, MeshCacheSource& ref, std::string& key)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.read(reinterpret_cast<char*>(&ref), sizeof(ref))) return false;
+        key.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return !key.empty();
+    }
+
+    bool WriteRef(const std::string& path, const MeshCacheSource& ref, const std::string& key)
+    {
+        std::string temp = TempPath(path);
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&ref), sizeof(ref));
+            out.write(key.data(), static_cast<std::streamsize>(key.size()));
+            if (!out.good()) {
+                out.close();
+                std::error_code ec;
+                fs::remove(temp, ec);
+                return false;
+            }
+        }
+        return Commit(temp, path);
+    }
+
+    // a writer's temp file, old enough that the writer must have crashed
+    bool IsStaleTemp(const std::string& name, fs::file_time_type used, fs::file_time_type now)
+    {
+        return name.find(kTempMarker) != std::string::npos && now - used > kStaleTempAge;
+    }
+
+    const char* Extension(CacheKind kind)
+    {
+        return kind == CacheKind::Texture ? kTextureExtension : kMeshExtension;
+    }
+
+    bool StatFile(const std::string& path, uint64_t& size, int64_t& modified)
+    {
+        std::error_code ec;
+        size = fs::file_size(path, ec);
+        if (ec) return false;
+        modified = static_cast<int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+        return !ec;
+    }
+}
+
+CacheStore::CacheStore(std::string dir, uint64_t budgetBytes)
+    : directory(std::move(dir)), budget(budgetBytes)
+{
+}
+
+CacheStore& CacheStore::Default()
+{
+    static CacheStore store(DefaultDirectory());
+    return store;
+}
+
+std::string CacheStore::RefPath(const std::string& key) const
+{
+    return (fs::path(directory) / "refs" / (Hex(Hash64::Of(key.data(), key.size())) + kRefExtension)).string();
+}
+
+bool CacheStore::Resolve(const std::string& sourcePath, uint64_t optionsKey, uint32_t loaderVersion, CacheEntry& entry,
+    CacheKind kind)
+{
+    entry = CacheEntry();
+    entry.sourcePath = sourcePath;
+    MeshCacheSource& source = entry.source;
+    if (!StatFile(sourcePath, source.size, source.modifiedTime)) return false;
+    source.optionsKey = optionsKey;
+    source.loaderVersion = loaderVersion;
+
+    // reuse the hash from the last visit unless the source was touched since
+    const std::string refKey = RefKey(sourcePath);
+    const std::string refPath = RefPath(refKey);
+    MeshCacheSource ref;
+    std::string storedKey;
+    if (ReadRef(refPath, ref, storedKey) && storedKey == refKey
+        && ref.size == source.size && ref.modifiedTime == source.modifiedTime) {
+        source.contentHash = ref.contentHash;
+    }
+    else {
+        if (!HashFile(sourcePath, source.contentHash)) return false;
+        std::error_code ec;
+        fs::create_directories(fs::path(refPath).parent_path(), ec);
+        WriteRef(refPath, source, refKey);
+    }
+
+    Hash64 key;
+    key.Update(&source.contentHash, sizeof(source.contentHash));
+    key.Update(&source.size, sizeof(source.size));
+    key.Update(&source.optionsKey, sizeof(source.optionsKey));
+    key.Update(&source.loaderVersion, sizeof(source.loaderVersion));
+    entry.path = (fs::path(directory) / (Hex(key.Digest()) + Extension(kind))).string();
+    return true;
+}
+
+template <typename Cache>
+CacheStatus CacheStore::OpenEntry(const CacheEntry& entry, Cache& cache)
+{
+    CacheStatus status = cache.Open(entry.path);
+    std::string reason = cache.Error();
+    if (status == CacheStatus::Ok) {
+        // the name says what it should hold, the stamp has to agree
+        const MeshCacheSource& built = cache.Source();
+        if (built.contentHash != entry.source.contentHash || built.size != entry.source.size ||
+            built.optionsKey != entry.source.optionsKey || built.loaderVersion != entry.source.loaderVersion) {
+            cache = Cache();
+            status = CacheStatus::Invalid;
+            reason = "stamp does not match its key";
+        }
+    }
+
+    std::error_code ec;
+    if (status == CacheStatus::Ok) {
+        ++hits;
+        fs::last_write_time(entry.path, fs::file_time_type::clock::now(), ec);
+        return status;
+    }
+
+    ++misses;
+    if (status == CacheStatus::Invalid) {
+        LOG_WARNING("cache", "Rejecting cache " << entry.path << ": " << reason << ", rebuilding");
+        fs::remove(entry.path, ec);
+    }
+    return status;
+}
+
+CacheStatus CacheStore::Open(const CacheEntry& entry, MeshCache& cache)
+{
+    return OpenEntry(entry, cache);
+}
+
+CacheStatus CacheStore::Open(const CacheEntry& entry, TextureCache& cache)
+{
+    return OpenEntry(entry, cache);
+}
+
+template <typename Write>
+bool CacheStore::StoreEntry(const CacheEntry& entry, Write write)
+{
+    // an edit made while the entry was built would file it under the old content
+    uint64_t size = 0;
+    int64_t modified = 0;
+    if (!StatFile(entry.sourcePath, size, modified) || size != entry.source.size || modified != entry.source.modifiedTime) {
+        LOG_WARNING("cache", entry.sourcePath << " changed while loading, not caching it");
+        return false;
+    }
+
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    const std::string temp = TempPath(entry.path);
+    if (!write(temp) || !Commit(temp, entry.path)) {
+        fs::remove(temp, ec);
+        LOG_WARNING("cache", "Could not write cache to: " << entry.path);
+        return false;
+    }
+    ++writes;
+
+    Evict(entry.path);
+    return true;
+}
+
+bool CacheStore::Store(const CacheEntry& entry, const MeshView& mesh, MeshCacheEncoding encoding)
+{
+    return StoreEntry(entry, [&](const std::string& temp) { return MeshCache::Write(temp, entry.source, mesh, encoding); });
+}
+
+bool CacheStore::Store(const CacheEntry& entry, const TextureImage& image)
+{
+    return StoreEntry(entry, [&](const std::string& temp) { return TextureCache::Write(temp, entry.source, image); });
+}
+
+uint64_t CacheStore::Evict(const std::string& keep)
+{
+    struct File {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type used;
+    };
+
+    std::error_code ec;
+    std::vector<File> files;
+    uint64_t total = 0;
+    const auto now = fs::file_time_type::clock::now();
+    for (const fs::directory_entry& item : fs::directory_iterator(directory, ec)) {
+        if (!item.is_regular_file(ec)) continue;
+        const std::string name = item.path().filename().string();
+        const fs::file_time_type used = item.last_write_time(ec);
+        if (ec) continue;
+
+        if (name.find(kTempMarker) != std::string::npos) {
+            if (IsStaleTemp(name, used, now)) fs::remove(item.path(), ec);
+            continue;
+        }
+        const fs::path extension = item.path().extension();
+        if (extension != kMeshExtension && extension != kTextureExtension) continue;
+
+        const uint64_t size = item.file_size(ec);
+        if (ec) continue;
+        files.push_back({ item.path(), size, used });
+        total += size;
+    }
+
+    // refs are tiny and not budgeted, but the ones of deleted sources and
+    // crashed ref writes would pile up forever
+    for (const fs::directory_entry& item : fs::directory_iterator(fs::path(directory) / "refs", ec)) {
+        if (!item.is_regular_file(ec)) continue;
+        const std::string name = item.path().filename().string();
+        const fs::file_time_type used = item.last_write_time(ec);
+        if (ec) continue;
+
+        if (name.find(kTempMarker) != std::string::npos) {
+            if (IsStaleTemp(name, used, now)) fs::remove(item.path(), ec);
+            continue;
+        }
+        if (item.path().extension() != kRefExtension) continue;
+        MeshCacheSource ref;
+        std::string key;
+        if (!ReadRef(item.path().string(), ref, key)) {
+            fs::remove(item.path(), ec);
+            continue;
+        }
+        // only a source known to be gone drops its ref, one that can't be
+        // checked (an offline share, no access) may still be there
+        const bool sourceExists = fs::exists(key, ec);
+        if (!sourceExists && !ec) fs::remove(item.path(), ec);
+    }
+
+    if (total <= budget) return 0;
+
+    // oldest use first
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.used < b.used; });
+
+    uint64_t freed = 0;
+    const fs::path kept(keep);
+    for (const File& file : files) {
+        if (total <= budget) break;
+        if (!keep.empty() && file.path == kept) continue;
+
+        // entries still mapped elsewhere may refuse to go, skip them
+        if (!fs::remove(file.path, ec) || ec) continue;
+        total -= file.size;
+        freed += file.size;
+        ++evictions;
+    }
+    evictedBytes += freed;
+    return freed;
+}
+
+CacheStoreStats CacheStore::Stats() const
+{
+    CacheStoreStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.writes = writes;
+    stats.evictions = evictions;
+    stats.evictedBytes = evictedBytes;
+    return stats;
+}
@@ -0,0 +1,142 @@
+#include "../include/hash.h"
+#include "../include/mapped_file.h"
+#include <cstring>
+
+namespace {
+    constexpr uint64_t kPrime1 = 11400714785074694791ull;
+    constexpr uint64_t kPrime2 = 14029467366897019727ull;
+    constexpr uint64_t kPrime3 = 1609587929392839161ull;
+    constexpr uint64_t kPrime4 = 9650029242287828579ull;
+    constexpr uint64_t kPrime5 = 2870177450012600261ull;
+
+    inline uint64_t Rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // little-endian loads, the format is defined on little-endian bytes
+    inline uint64_t Read64(const unsigned char* p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t Read32(const unsigned char* p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * kPrime2;
+        acc = Rotl(acc, 31);
+        return acc * kPrime1;
+    }
+
+    inline uint64_t MergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= Round(0, value);
+        return acc * kPrime1 + kPrime4;
+    }
+}
+
+Hash64::Hash64(uint64_t seedValue)
+    : seed(seedValue)
+{
+    lanes[0] = seed + kPrime1 + kPrime2;
+    lanes[1] = seed + kPrime2;
+    lanes[2] = seed;
+    lanes[3] = seed - kPrime1;
+}
+
+void Hash64::Update(const void* data, size_t size)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    totalSize += size;
+
+    // top up a partial stripe first
+    if (buffered > 0) {
+        size_t take = 32 - buffered;
+        if (take > size) take = size;
+        std::memcpy(buffer + buffered, p, take);
+        buffered += take;
+        p += take;
+        if (buffered < 32) return;
+
+        for (int i = 0; i < 4; ++i) lanes[i] = Round(lanes[i], Read64(buffer + i * 8));
+        buffered = 0;
+    }
+
+    // full 32-byte stripes straight from the input
+    while (end - p >= 32) {
+        lanes[0] = Round(lanes[0], Read64(p));
+        lanes[1] = Round(lanes[1], Read64(p + 8));
+        lanes[2] = Round(lanes[2], Read64(p + 16));
+        lanes[3] = Round(lanes[3], Read64(p + 24));
+        p += 32;
+    }
+
+    if (p < end) {
+        buffered = static_cast<size_t>(end - p);
+        std::memcpy(buffer, p, buffered);
+    }
+}
+
+uint64_t Hash64::Digest() const
+{
+    uint64_t h;
+    if (totalSize >= 32) {
+        h = Rotl(lanes[0], 1) + Rotl(lanes[1], 7) + Rotl(lanes[2], 12) + Rotl(lanes[3], 18);
+        for (int i = 0; i < 4; ++i) h = MergeRound(h, lanes[i]);
+    }
+    else {
+        h = seed + kPrime5;
+    }
+    h += totalSize;
+
+    // tail bytes that did not fill a stripe
+    const unsigned char* p = buffer;
+    const unsigned char* end = buffer + buffered;
+    while (end - p >= 8) {
+        h ^= Round(0, Read64(p));
+        h = Rotl(h, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+        h = Rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * kPrime5;
+        h = Rotl(h, 11) * kPrime1;
+        ++p;
+    }
+
+    // final avalanche
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t Hash64::Of(const void* data, size_t size, uint64_t seed)
+{
+    Hash64 hash(seed);
+    hash.Update(data, size);
+    return hash.Digest();
+}
+
+bool HashFile(const std::string& path, uint64_t& hash)
+{
+    MappedFile file(path);
+    if (!file.IsOpen()) return false;
+    hash = Hash64::Of(file.Data(), file.Size());
+    return true;
+}
@@ -0,0 +1,244 @@
+#include "../include/log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+    std::atomic<int> minLevel{ static_cast<int>(LogLevel::Info) };
+    std::atomic<uint64_t> dropped{ 0 };
+
+    // set once the queue is gone at exit, later messages are written directly
+    std::atomic<bool> shutDown{ false };
+
+    uint64_t NowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    const char* LevelPrefix(LogLevel level)
+    {
+        switch (level) {
+        case LogLevel::Debug: return "Debug: ";
+        case LogLevel::Warning: return "Warning: ";
+        case LogLevel::Error: return "Error: ";
+        default: return "";
+        }
+    }
+
+    void WriteConsole(const LogRecord& record)
+    {
+        std::ostream& out = record.level >= LogLevel::Warning ? std::cerr : std::cout;
+        out << "[" << record.channel << "] " << LevelPrefix(record.level);
+        out.write(record.text, static_cast<std::streamsize>(record.length));
+        out << "\n";
+    }
+
+    // bounded multi-producer queue, each slot's sequence tells producers
+    // and the consumer whose turn it is (vyukov's ring)
+    struct Slot {
+        std::atomic<uint64_t> sequence{ 0 };
+        LogLevel level = LogLevel::Info;
+        const char* channel = nullptr;
+        uint64_t timeNs = 0;
+        size_t length = 0;
+        char text[Log::kMessageSize];
+    };
+
+    class Queue {
+    public:
+        Queue()
+        {
+            for (size_t i = 0; i < Log::kQueueSize; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+            worker = std::thread(&Queue::Drain, this);
+        }
+
+        ~Queue()
+        {
+            stopping.store(true, std::memory_order_release);
+            wake.notify_one();
+            worker.join();
+            // anything queued after the worker's last look
+            while (Pop()) {}
+            shutDown.store(true, std::memory_order_release);
+        }
+
+        bool TryPush(LogLevel level, const char* channel, uint64_t timeNs, const char* text, size_t length)
+        {
+            uint64_t position = enqueued.load(std::memory_order_relaxed);
+            Slot* slot = nullptr;
+            while (true) {
+                slot = &slots[position % Log::kQueueSize];
+                const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+                if (sequence == position) {
+                    if (enqueued.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                }
+                else if (sequence < position) {
+                    return false;
+                }
+                else {
+                    position = enqueued.load(std::memory_order_relaxed);
+                }
+            }
+            slot->level = level;
+            slot->channel = channel;
+            slot->timeNs = timeNs;
+            slot->length = length;
+            std::memcpy(slot->text, text, length);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            if (sleeping.load(std::memory_order_acquire)) wake.notify_one();
+            return true;
+        }
+
+        void SetSink(Log::Sink newSink)
+        {
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            sink = std::move(newSink);
+        }
+
+        void Flush()
+        {
+            const uint64_t target = enqueued.load(std::memory_order_acquire);
+            while (written.load(std::memory_order_acquire) < target) {
+                wake.notify_one();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+    private:
+        // pop one message into the sink, false if the next slot isn't filled yet
+        bool Pop()
+        {
+            const uint64_t position = written.load(std::memory_order_relaxed);
+            Slot& slot = slots[position % Log::kQueueSize];
+            if (slot.sequence.load(std::memory_order_acquire) != position + 1) return false;
+
+            const LogRecord record{ slot.level, slot.channel, slot.timeNs, slot.text, slot.length };
+            Deliver(record);
+            slot.sequence.store(position + Log::kQueueSize, std::memory_order_release);
+            written.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        void Deliver(const LogRecord& record)
+        {
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            if (sink) sink(record);
+            else WriteConsole(record);
+        }
+
+        void ReportDropped()
+        {
+            const uint64_t count = dropped.load(std::memory_order_relaxed);
+            if (count == reportedDrops) return;
+            const std::string text = std::to_string(count - reportedDrops) + " messages dropped, the log queue was full";
+            reportedDrops = count;
+            Deliver(LogRecord{ LogLevel::Warning, "log", NowNs(), text.data(), text.size() });
+        }
+
+        void Drain()
+        {
+            while (true) {
+                bool any = false;
+                while (Pop()) any = true;
+                ReportDropped();
+                if (any) {
+                    std::lock_guard<std::mutex> lock(sinkMutex);
+                    std::cout.flush();
+                    continue;
+                }
+                if (stopping.load(std::memory_order_acquire)) return;
+
+                // a producer that misses the flag is picked up by the timeout
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                sleeping.store(true, std::memory_order_release);
+                wake.wait_for(lock, std::chrono::milliseconds(50));
+                sleeping.store(false, std::memory_order_release);
+            }
+        }
+
+        Slot slots[Log::kQueueSize];
+        std::atomic<uint64_t> enqueued{ 0 };
+        std::atomic<uint64_t> written{ 0 };
+        uint64_t reportedDrops = 0;
+
+        std::mutex sinkMutex;
+        Log::Sink sink;
+
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::atomic<bool> sleeping{ false };
+        std::atomic<bool> stopping{ false };
+        std::thread worker;
+    };
+
+    // made on the first message, so programs that never log start no thread
+    Queue& GetQueue()
+    {
+        static Queue queue;
+        return queue;
+    }
+}
+
+LogLevel Log::Level()
+{
+    return static_cast<LogLevel>(minLevel.load(std::memory_order_relaxed));
+}
+
+void Log::SetLevel(LogLevel level)
+{
+    minLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void Log::SetSink(Sink sink)
+{
+    GetQueue().SetSink(std::move(sink));
+}
+
+void Log::Write(LogLevel level, const char* channel, const char* text, size_t length)
+{
+    length = std::min(length, kMessageSize);
+    const uint64_t timeNs = NowNs();
+    if (shutDown.load(std::memory_order_acquire)) {
+        WriteConsole(LogRecord{ level, channel, timeNs, text, length });
+        return;
+    }
+
+    Queue& queue = GetQueue();
+    while (!queue.TryPush(level, channel, timeNs, text, length)) {
+        if (level < LogLevel::Warning) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void Log::Flush()
+{
+    if (!shutDown.load(std::memory_order_acquire)) GetQueue().Flush();
+}
+
+uint64_t Log::Dropped()
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+LogLine::LogLine(LogLevel level, const char* channel)
+    : level(level), channel(channel), buffer(text, sizeof(text)), stream(&buffer)
+{
+}
+
+LogLine::~LogLine()
+{
+    size_t length = buffer.Size();
+    // mark a message that did not fit
+    if (length == sizeof(text)) std::memcpy(text + length - 3, "...", 3);
+    Log::Write(level, channel, text, length);
+}
@@ -0,0 +1,222 @@
+#include "../include/lz_codec.h"
+#include <cstdint>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    constexpr int kHashBits = 14;
+    constexpr size_t kMinMatch = 4;
+    constexpr size_t kMaxOffset = 65535;
+
+    // matches stop this far before the end and never start in the last
+    // kMatchSearchEnd bytes, which keeps every 4 and 8 byte load in bounds
+    constexpr size_t kLastLiterals = 5;
+    constexpr size_t kMatchSearchEnd = 12;
+
+    inline uint32_t Load32(const unsigned char* p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t Load64(const unsigned char* p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t HashSequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - kHashBits);
+    }
+
+    inline unsigned TrailingZeroBytes(uint64_t x)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<unsigned>(index) >> 3;
+#else
+        return static_cast<unsigned>(__builtin_ctzll(x)) >> 3;
+#endif
+    }
+
+    // length of the common run at a and b, with a never passing limit
+    inline size_t MatchLength(const unsigned char* a, const unsigned char* b, const unsigned char* limit)
+    {
+        const unsigned char* start = a;
+        while (a + 8 <= limit) {
+            uint64_t diff = Load64(a) ^ Load64(b);
+            if (diff) return static_cast<size_t>(a - start) + TrailingZeroBytes(diff);
+            a += 8;
+            b += 8;
+        }
+        while (a < limit && *a == *b) {
+            ++a;
+            ++b;
+        }
+        return static_cast<size_t>(a - start);
+    }
+
+    // lengths of 15 and up continue in 255-valued bytes
+    inline void WriteLength(unsigned char*& op, size_t length)
+    {
+        while (length >= 255) {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = static_cast<unsigned char>(length);
+    }
+
+    inline bool ReadLength(const unsigned char*& ip, const unsigned char* end, size_t& length)
+    {
+        unsigned char byte;
+        do {
+            if (ip >= end || length > (SIZE_MAX >> 1)) return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // token, literals, and unless this is the last sequence an offset and match length
+    inline void EmitSequence(unsigned char*& op, const unsigned char* literals, size_t literalCount,
+        size_t offset, size_t matchLength)
+    {
+        unsigned char* token = op++;
+        if (literalCount >= 15) {
+            *token = 15 << 4;
+            WriteLength(op, literalCount - 15);
+        }
+        else {
+            *token = static_cast<unsigned char>(literalCount << 4);
+        }
+        if (literalCount > 0) std::memcpy(op, literals, literalCount);
+        op += literalCount;
+        if (matchLength == 0) return;
+
+        *op++ = static_cast<unsigned char>(offset);
+        *op++ = static_cast<unsigned char>(offset >> 8);
+        matchLength -= kMinMatch;
+        if (matchLength >= 15) {
+            *token |= 15;
+            WriteLength(op, matchLength - 15);
+        }
+        else {
+            *token |= static_cast<unsigned char>(matchLength);
+        }
+    }
+}
+
+size_t LzBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t LzCompress(const void* in, size_t size, void* out)
+{
+    const unsigned char* src = static_cast<const unsigned char*>(in);
+    const unsigned char* end = src + size;
+    unsigned char* op = static_cast<unsigned char*>(out);
+    const unsigned char* anchor = src;
+
+    if (size > kMatchSearchEnd) {
+        const unsigned char* searchEnd = end - kMatchSearchEnd;
+        const unsigned char* matchLimit = end - kLastLiterals;
+        uint32_t table[1 << kHashBits] = {};
+
+        const unsigned char* ip = src;
+        size_t misses = 0;
+        while (ip < searchEnd) {
+            const uint32_t sequence = Load32(ip);
+            const uint32_t h = HashSequence(sequence);
+            const unsigned char* ref = src + table[h];
+            table[h] = static_cast<uint32_t>(ip - src);
+
+            if (ref >= ip || static_cast<size_t>(ip - ref) > kMaxOffset || Load32(ref) != sequence) {
+                // skip faster through data that does not compress
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            // grow the match backwards over pending literals
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const size_t length = kMinMatch + MatchLength(ip + kMinMatch, ref + kMinMatch, matchLimit);
+            EmitSequence(op, anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - ref), length);
+            ip += length;
+            anchor = ip;
+
+            // index a position inside the match so runs chain together
+            if (ip - 2 < searchEnd) table[HashSequence(Load32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+        }
+    }
+
+    EmitSequence(op, anchor, static_cast<size_t>(end - anchor), 0, 0);
+    return static_cast<size_t>(op - static_cast<unsigned char*>(out));
+}
+
+bool LzDecompress(const void* in, size_t inSize, void* out, size_t outSize)
+{
+    const unsigned char* ip = static_cast<const unsigned char*>(in);
+    const unsigned char* ipEnd = ip + inSize;
+    unsigned char* dst = static_cast<unsigned char*>(out);
+    unsigned char* op = dst;
+    unsigned char* opEnd = dst + outSize;
+
+    while (true) {
+        if (ip >= ipEnd) return false;
+        const unsigned char token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !ReadLength(ip, ipEnd, literals)) return false;
+        if (literals > static_cast<size_t>(ipEnd - ip) || literals > static_cast<size_t>(opEnd - op)) return false;
+        if (ipEnd - ip >= static_cast<ptrdiff_t>(literals + 16) && opEnd - op >= static_cast<ptrdiff_t>(literals + 16)) {
+            // room to overshoot, copy in whole 16-byte steps
+            for (size_t i = 0; i < literals; i += 16) std::memcpy(op + i, ip + i, 16);
+        }
+        else if (literals > 0) {
+            std::memcpy(op, ip, literals);
+        }
+        ip += literals;
+        op += literals;
+
+        // the last sequence carries literals only
+        if (ip == ipEnd) return op == opEnd;
+
+        if (ipEnd - ip < 2) return false;
+        const size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) return false;
+
+        size_t length = token & 15;
+        if (length == 15 && !ReadLength(ip, ipEnd, length)) return false;
+        length += kMinMatch;
+        if (length > static_cast<size_t>(opEnd - op)) return false;
+
+        // copies overlap when offset < length, which repeats the run
+        const unsigned char* ref = op - offset;
+        unsigned char* matchEnd = op + length;
+        if (offset >= 16 && opEnd - matchEnd >= 16) {
+            for (; op < matchEnd; op += 16, ref += 16) std::memcpy(op, ref, 16);
+            op = matchEnd;
+            continue;
+        }
+        if (offset >= 8) {
+            while (matchEnd - op >= 8) {
+                std::memcpy(op, ref, 8);
+                op += 8;
+                ref += 8;
+            }
+        }
+        while (op < matchEnd) *op++ = *ref++;
+    }
+}
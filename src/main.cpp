@@ -1,14 +1,19 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#include <iostream>
 #include <vector>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
 
 #include "../include/shader.h"
 #include "../include/camera.h"
 #include "../include/loader.h"
+#include "../include/log.h"
+#include "../include/cache_store.h"
+#include "../include/mesh_load_service.h"
+#include "../include/profiler.h"
+#include "../include/texture_streamer.h"
 #include "../include/renderer.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "../include/stb_image.h"
@@ -26,9 +31,7 @@
 namespace fs = std::filesystem;
 
 // Global mesh and camera
-std::vector<Vertex> emptyVerts;
-std::vector<unsigned int> emptyInds;
-Renderer mesh(emptyVerts, emptyInds);
+Renderer mesh;
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f), 0.0f, 0.0f, 3.0f, 0.5f, 90.0f);
 
 // State
@@ -43,6 +46,17 @@ float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 std::string file;
 ImGui::FileBrowser fileDialog;
+bool recordTrace = false;
+const char* traceFile = "trace.json";
+
+// What each material samples: its streamed diffuse map once there is one,
+// until then and for materials without a map a 1x1 texture of its Kd
+struct MaterialTexture {
+    size_t slot = SIZE_MAX;
+    unsigned int color = 0;
+};
+std::vector<MaterialTexture> materialTextures;
+std::vector<std::string> materialMaps;  // streamer slot order
 
 // Forward declarations
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -50,18 +64,68 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
 void processInput(GLFWwindow* window);
 
-// Mesh loader
-Renderer load_shader_and_mesh(std::string filePath) {
-    Loader loader;
-    loader.GetVertices(filePath);
-    std::cout << "Loaded mesh: " << loader.vertices.size() << " vertices, "
-        << loader.indices.size() << " indices\n";
-    return Renderer(loader.vertices, loader.indices);
+unsigned int color_texture(const glm::vec3& color) {
+    const glm::vec3 clamped = glm::clamp(color, 0.0f, 1.0f);
+    const unsigned char texel[4] = {
+        static_cast<unsigned char>(clamped.x * 255.0f + 0.5f),
+        static_cast<unsigned char>(clamped.y * 255.0f + 0.5f),
+        static_cast<unsigned char>(clamped.z * 255.0f + 0.5f),
+        255 };
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+void release_material_textures() {
+    for (const MaterialTexture& material : materialTextures) {
+        if (material.color != 0) glDeleteTextures(1, &material.color);
+    }
+    materialTextures.clear();
+    materialMaps.clear();
+}
+
+// Upload a finished background load, returns false if it produced nothing
+bool upload_mesh(const std::string& filePath, Loader& loader) {
+    PROFILE_ZONE("upload mesh");
+    MeshView view = loader.Mesh();
+    if (view.vertexCount == 0 || view.indexCount == 0) {
+        LOG_ERROR("viewer", "No mesh loaded from " << filePath);
+        return false;
+    }
+    LOG_INFO("viewer", "Loaded mesh: " << view.vertexCount << " vertices, "
+        << view.indexCount << " indices");
+
+    // uploads straight from the loader's storage, which is the mapped cache
+    // file on a cache hit. the cpu-side mesh is freed with the loader
+    mesh = Renderer(view);
+
+    // Materials sharing a diffuse map share its streamer slot
+    release_material_textures();
+    for (size_t i = 0; i < view.materialCount; ++i) {
+        const MeshMaterial& material = view.materials[i];
+        MaterialTexture texture;
+        texture.color = color_texture(material.diffuse);
+        if (!material.diffuseMap.empty()) {
+            auto found = std::find(materialMaps.begin(), materialMaps.end(), material.diffuseMap);
+            texture.slot = static_cast<size_t>(found - materialMaps.begin());
+            if (found == materialMaps.end()) materialMaps.push_back(material.diffuseMap);
+        }
+        materialTextures.push_back(texture);
+    }
+    mesh.materials.resize(materialTextures.size());
+    if (view.materialCount > 0) {
+        LOG_INFO("viewer", view.materialCount << " materials, " << view.submeshCount << " submeshes");
+    }
+    return true;
 }
 
 int main() {
     if (!glfwInit()) {
-        std::cout << "Failed to initialize GLFW\n";
+        LOG_ERROR("viewer", "Failed to initialize GLFW");
         return -1;
     }
 
@@ -70,7 +134,7 @@ int main() {
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL Mesh", nullptr, nullptr);
     if (!window) {
-        std::cout << "Failed to create window\n";
+        LOG_ERROR("viewer", "Failed to create window");
         glfwTerminate();
         return -1;
     }
@@ -85,11 +149,11 @@ int main() {
     ImGui_ImplOpenGL3_Init("#version 330");
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD\n";
+        LOG_ERROR("viewer", "Failed to initialize GLAD");
         return -1;
     }
 
-    std::cout << "OpenGL version: " << glGetString(GL_VERSION) << "\n";
+    LOG_INFO("viewer", "OpenGL version: " << glGetString(GL_VERSION));
 
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
     glEnable(GL_DEPTH_TEST);
@@ -98,13 +162,21 @@ int main() {
     Shader shader("assets/shaders/vertex.vert", "assets/shaders/fragment.frag");
     stbi_set_flip_vertically_on_load(true);
 
+    // Parses on a worker thread, uploads happen below on this one
+    MeshLoadService meshLoads;
+    // Decodes on a worker thread, uploads a slice per frame
+    TextureStreamer textures;
+
     // Default camera setup
     camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
     camera.pitch = 0.0f;
     camera.yaw = -90.0f;
     camera.updateCamera();
 
+    Profiler::NameThread("main");
+
     while (!glfwWindowShouldClose(window)) {
+        PROFILE_ZONE("frame");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -116,52 +188,82 @@ int main() {
         fileDialog.Display();
 
         if (fileDialog.HasSelected()) {
-            file = fileDialog.GetSelected().string();
-            mesh = load_shader_and_mesh(file);
-            meshLoaded = true;
+            meshLoads.Request(fileDialog.GetSelected().string());
             fileDialog.ClearSelected();
+        }
 
-            // Load texture from same directory
-            fs::path filePath(file);
-            fs::path texturePath = filePath.parent_path() / "diffuse.jpg";
-            std::string textureFile = texturePath.string();
-
-            int width, height, nrChannels;
-            unsigned char* data = stbi_load(textureFile.c_str(), &width, &height, &nrChannels, 0);
-            if (data) {
-                unsigned int texture;
-                glGenTextures(1, &texture);
-                glBindTexture(GL_TEXTURE_2D, texture);
-
-                GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
-                glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
-
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // The old mesh keeps drawing until the new one is ready
+        {
+            PROFILE_ZONE("poll loads");
+            std::string finishedPath;
+            std::unique_ptr<Loader> finished;
+            if (meshLoads.Poll(finishedPath, finished) && upload_mesh(finishedPath, *finished)) {
+                finished.reset();
+                file = finishedPath;
+                meshLoaded = true;
+
+                // Stream the material maps, or without materials the texture from
+                // the same directory. A placeholder shows meanwhile
+                if (!materialTextures.empty()) {
+                    textures.Request(materialMaps);
+                }
+                else {
+                    fs::path texturePath = fs::path(file).parent_path() / "diffuse.jpg";
+                    textures.Request(texturePath.string());
+                }
+
+                // Reset camera to focus on origin
+                camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
+                camera.pitch = 0.0f;
+                camera.yaw = -90.0f;
+                camera.updateCamera();
+            }
+        }
 
-                glUseProgram(shader.ID);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, texture);
-                glUniform1i(glGetUniformLocation(shader.ID, "materialDiffuse"), 0);
+        textures.Update();
 
-                stbi_image_free(data);
+        // Record zones until unticked, then write them out for chrome://tracing
+        if (ImGui::Checkbox("Record trace", &recordTrace)) {
+            if (recordTrace) {
+                Profiler::Clear();
+                Profiler::Start();
             }
             else {
-                std::cerr << "Failed to load texture: " << textureFile << "\n";
+                Profiler::Stop();
+                if (Profiler::WriteChromeTrace(traceFile)) LOG_INFO("viewer", "Wrote trace: " << traceFile);
+                else LOG_ERROR("viewer", "Could not write trace: " << traceFile);
             }
-
-            // Reset camera to focus on origin
-            camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
-            camera.pitch = 0.0f;
-            camera.yaw = -90.0f;
-            camera.updateCamera();
         }
 
         ImGui::Begin("File Info");
         ImGui::TextWrapped("Loaded file: %s", file.c_str());
+        if (meshLoads.Busy()) {
+            ImGui::TextWrapped("Loading: %s", meshLoads.PendingPath().c_str());
+            ImGui::ProgressBar(meshLoads.Progress());
+            if (ImGui::Button("Cancel")) meshLoads.Cancel();
+        }
+        ImGui::Checkbox("Optimize meshes on load", &meshLoads.optimizeMeshes);
+        ImGui::Checkbox("Compact vertices", &meshLoads.compactVertices);
+        ImGui::Checkbox("16-bit indices", &meshLoads.narrowIndices);
+        if (meshLoaded && !mesh.lods.empty()) {
+            ImGui::Text("LOD: %zu of %zu, %u triangles", mesh.currentLod, mesh.lods.size(),
+                mesh.lods[mesh.currentLod].indexCount / 3);
+        }
+        if (meshLoaded && !mesh.meshlets.empty()) {
+            ImGui::Checkbox("Cull meshlets", &mesh.cullMeshlets);
+            ImGui::Text("Meshlets: %zu of %zu visible", mesh.visibleMeshlets, mesh.meshlets.size());
+        }
+        if (meshLoaded && !mesh.materials.empty()) {
+            ImGui::Text("Materials: %zu, %zu textures", mesh.materials.size(), materialMaps.size());
+        }
+        if (textures.Streaming()) {
+            ImGui::Text("Texture: streaming %d%%", static_cast<int>(textures.Progress() * 100.0f));
+        }
+        CacheStoreStats cacheStats = CacheStore::Default().Stats();
+        ImGui::Text("Mesh cache: %llu hits, %llu misses, %llu evicted",
+            static_cast<unsigned long long>(cacheStats.hits),
+            static_cast<unsigned long long>(cacheStats.misses),
+            static_cast<unsigned long long>(cacheStats.evictions));
         ImGui::End();
 
         float currentFrame = static_cast<float>(glfwGetTime());
@@ -170,35 +272,65 @@ int main() {
 
         processInput(window);
 
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        {
+            PROFILE_ZONE("draw");
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glm::mat4 modelMat = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, -0.5f, -0.5f));
-        modelMat = glm::scale(modelMat, glm::vec3(0.01f, 0.01f, 0.01f));
+            glm::mat4 modelMat = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, -0.5f, -0.5f));
+            modelMat = glm::scale(modelMat, glm::vec3(0.01f, 0.01f, 0.01f));
 
-        glm::mat4 projectionMat = glm::perspective(glm::radians(45.0f),
-            static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT),
-            0.1f, 100.0f);
+            const float fovY = glm::radians(45.0f);
+            glm::mat4 projectionMat = glm::perspective(fovY,
+                static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT),
+                0.1f, 100.0f);
 
-        glm::mat4 viewMat = camera.lookAtMatrix();
+            glm::mat4 viewMat = camera.lookAtMatrix();
 
-        shader.use();
-        shader.setMat4("model", modelMat);
-        shader.setMat4("projection", projectionMat);
-        shader.setMat4("view", viewMat);
-        shader.setVec3("lightPos", glm::vec3(1.2f, 1.0f, 2.0f));
-        shader.setVec3("viewPos", camera.position);
+            shader.use();
+            shader.setMat4("model", modelMat);
+            shader.setMat4("projection", projectionMat);
+            shader.setMat4("view", viewMat);
+            shader.setVec3("lightPos", glm::vec3(1.2f, 1.0f, 2.0f));
+            shader.setVec3("viewPos", camera.position);
 
-        if (meshLoaded && !mesh.vertices.empty() && !mesh.indices.empty()) {
-            mesh.DrawMesh();
+            if (meshLoaded && !mesh.Empty()) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, textures.Texture());
+                glUniform1i(glGetUniformLocation(shader.ID, "materialDiffuse"), 0);
+                const VertexQuantization& quantization = mesh.layout.quantization;
+                shader.setVec3("positionOffset", quantization.positionOffset);
+                shader.setVec3("positionScale", quantization.positionScale);
+                shader.setVec2("uvOffset", quantization.uvOffset);
+                shader.setVec2("uvScale", quantization.uvScale);
+                shader.setBool("octNormals", mesh.layout.format.normal == AttributeFormat::Oct8
+                    || mesh.layout.format.normal == AttributeFormat::Oct16);
+                for (size_t i = 0; i < mesh.materials.size(); ++i) {
+                    const MaterialTexture& material = materialTextures[i];
+                    const unsigned int streamed = material.slot != SIZE_MAX ? textures.Texture(material.slot) : 0;
+                    mesh.materials[i] = { shader.ID, streamed != 0 ? streamed : material.color };
+                }
+                mesh.SelectLod(camera, modelMat, fovY, static_cast<float>(SCR_HEIGHT));
+                mesh.CullMeshlets(camera, modelMat, projectionMat);
+                mesh.DrawMesh();
+            }
         }
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        glfwSwapBuffers(window);
+        {
+            PROFILE_ZONE("draw ui");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        {
+            PROFILE_ZONE("swap buffers");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
 
+    mesh.Release();
+    release_material_textures();
+    textures.Release();
     glfwDestroyWindow(window);
     glfwTerminate();
     ImGui_ImplOpenGL3_Shutdown();
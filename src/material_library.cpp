@@ -0,0 +1,123 @@
+#include "../include/material_library.h"
+#include "../include/number_parse.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace {
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    std::string_view Trim(std::string_view text)
+    {
+        while (!text.empty() && IsSpace(text.front())) text.remove_prefix(1);
+        while (!text.empty() && IsSpace(text.back())) text.remove_suffix(1);
+        return text;
+    }
+
+    // up to count floats, fields that are missing or malformed keep their value
+    int ReadFloats(std::string_view fields, float* out, int count)
+    {
+        const char* p = fields.data();
+        const char* end = p + fields.size();
+        int read = 0;
+        while (read < count) {
+            while (p < end && IsSpace(*p)) ++p;
+            if (p == end) break;
+            float value = 0.0f;
+            const NumberResult result = ParseFloat(p, end, value);
+            if (result.error != NumberError::None) break;
+            out[read++] = value;
+            p = result.ptr;
+        }
+        return read;
+    }
+
+    // "Kd 0.5" is grey, the missing channels repeat the first
+    glm::vec3 ReadColor(std::string_view fields, const glm::vec3& fallback)
+    {
+        float rgb[3] = { fallback.x, fallback.y, fallback.z };
+        const int read = ReadFloats(fields, rgb, 3);
+        if (read == 1) rgb[1] = rgb[2] = rgb[0];
+        return glm::vec3(rgb[0], rgb[1], rgb[2]);
+    }
+
+    // the last field, past any map options, relative to the library
+    std::string MapPath(std::string_view fields, const fs::path& directory)
+    {
+        size_t start = fields.size();
+        while (start > 0 && !IsSpace(fields[start - 1])) --start;
+        const std::string_view name = fields.substr(start);
+        if (name.empty()) return std::string();
+        return (directory / fs::path(std::string(name))).lexically_normal().string();
+    }
+}
+
+MaterialLibrary StampMaterialLibrary(const std::string& path)
+{
+    MaterialLibrary library;
+    library.path = path;
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(path, ec);
+    if (ec) return library;
+    const fs::file_time_type modified = fs::last_write_time(path, ec);
+    if (ec) return library;
+    library.size = static_cast<uint64_t>(size);
+    library.modifiedTime = static_cast<int64_t>(modified.time_since_epoch().count());
+    return library;
+}
+
+bool ReadMaterialLibrary(const std::string& path, std::vector<MeshMaterial>& materials)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const fs::path directory = fs::path(path).parent_path();
+
+    // statements before the first newmtl have no material to go to
+    MeshMaterial* material = nullptr;
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* lineEnd = newline ? newline : end;
+        std::string_view line = Trim(std::string_view(p, static_cast<size_t>(lineEnd - p)));
+        p = newline ? newline + 1 : end;
+        if (line.empty() || line.front() == '#') continue;
+
+        size_t split = 0;
+        while (split < line.size() && !IsSpace(line[split])) ++split;
+        const std::string_view keyword = line.substr(0, split);
+        const std::string_view fields = Trim(line.substr(split));
+
+        if (keyword == "newmtl") {
+            materials.emplace_back();
+            materials.back().name = std::string(fields);
+            material = &materials.back();
+            continue;
+        }
+        if (!material) continue;
+
+        if (keyword == "Ka") material->ambient = ReadColor(fields, material->ambient);
+        else if (keyword == "Kd") material->diffuse = ReadColor(fields, material->diffuse);
+        else if (keyword == "Ks") material->specular = ReadColor(fields, material->specular);
+        else if (keyword == "Ke") material->emissive = ReadColor(fields, material->emissive);
+        else if (keyword == "Ns") ReadFloats(fields, &material->shininess, 1);
+        else if (keyword == "d") ReadFloats(fields, &material->opacity, 1);
+        else if (keyword == "Tr") {
+            float transparency = 1.0f - material->opacity;
+            if (ReadFloats(fields, &transparency, 1) == 1) material->opacity = 1.0f - transparency;
+        }
+        else if (keyword == "map_Kd") material->diffuseMap = MapPath(fields, directory);
+        else if (keyword == "map_Ks") material->specularMap = MapPath(fields, directory);
+        else if (keyword == "map_Bump" || keyword == "map_bump" || keyword == "bump") material->bumpMap = MapPath(fields, directory);
+        else if (keyword == "map_d") material->alphaMap = MapPath(fields, directory);
+    }
+    return true;
+}
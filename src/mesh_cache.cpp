@@ -0,0 +1,516 @@
+#include "../include/mesh_cache.h"
+#include "../include/hash.h"
+#include "../include/mesh_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    // largest index, 0 for none
+    template <typename Index>
+    size_t MaxIndex(const Index* indices, size_t count)
+    {
+        Index highest = 0;
+        for (size_t i = 0; i < count; ++i) highest = std::max(highest, indices[i]);
+        return highest;
+    }
+
+    // the checksum only shows a stream is what was written, an encoder bug
+    // would still send indices past the vertices to the gpu
+    bool IndicesInRange(const void* indices, size_t count, uint32_t indexSize, size_t vertexCount, size_t& highest)
+    {
+        highest = indexSize == sizeof(unsigned short)
+            ? MaxIndex(static_cast<const unsigned short*>(indices), count)
+            : MaxIndex(static_cast<const unsigned int*>(indices), count);
+        return count == 0 || highest < vertexCount;
+    }
+
+    std::string IndexRangeError(size_t highest, size_t vertexCount)
+    {
+        return "index " + std::to_string(highest) + " out of range for " + std::to_string(vertexCount) + " vertices";
+    }
+
+    const char kMagic[8] = { 'O', 'B', 'J', 'M', 'E', 'S', 'H', 0x1A };
+
+    // section payloads start on this boundary so they can be used in place
+    constexpr uint64_t kSectionAlignment = 16;
+
+    uint64_t AlignUp(uint64_t value)
+    {
+        return (value + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+    }
+
+    // one section handed to the writer
+    struct SectionData {
+        uint32_t id;
+        const void* data;
+        uint64_t size;
+    };
+
+    // header fields describing a vertex layout and index size this build can read
+    MeshCacheHeader MakeHeader(const VertexLayout& layout, uint32_t indexSize)
+    {
+        MeshCacheHeader header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kMeshCacheVersion;
+        header.endianTag = kMeshCacheEndianTag;
+        header.headerSize = sizeof(MeshCacheHeader);
+        header.positionFormat = layout.format.position;
+        header.uvFormat = layout.format.uv;
+        header.normalFormat = layout.format.normal;
+        header.indexSize = static_cast<uint8_t>(indexSize);
+        header.vertexStride = layout.stride;
+        return header;
+    }
+
+    // hash a header as if its checksum field were zero
+    void HashHeader(Hash64& hash, MeshCacheHeader header)
+    {
+        header.checksum = 0;
+        hash.Update(&header, sizeof(header));
+    }
+
+    // MATL payload writer and reader, the layout is described in mesh_cache.h
+    template <typename T>
+    void Put(std::vector<unsigned char>& out, const T& value)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    void PutString(std::vector<unsigned char>& out, const std::string& text)
+    {
+        Put(out, static_cast<uint32_t>(text.size()));
+        out.insert(out.end(), text.begin(), text.end());
+    }
+
+    std::vector<unsigned char> PackMaterials(const MeshView& mesh)
+    {
+        std::vector<unsigned char> out;
+        Put(out, static_cast<uint32_t>(mesh.materialCount));
+        Put(out, static_cast<uint32_t>(mesh.materialLibraryCount));
+        for (size_t i = 0; i < mesh.materialLibraryCount; ++i) {
+            const MaterialLibrary& library = mesh.materialLibraries[i];
+            Put(out, library.size);
+            Put(out, library.modifiedTime);
+            PutString(out, library.path);
+        }
+        for (size_t i = 0; i < mesh.materialCount; ++i) {
+            const MeshMaterial& material = mesh.materials[i];
+            const float values[14] = {
+                material.ambient.x, material.ambient.y, material.ambient.z,
+                material.diffuse.x, material.diffuse.y, material.diffuse.z,
+                material.specular.x, material.specular.y, material.specular.z,
+                material.emissive.x, material.emissive.y, material.emissive.z,
+                material.shininess, material.opacity };
+            Put(out, values);
+            PutString(out, material.name);
+            PutString(out, material.diffuseMap);
+            PutString(out, material.specularMap);
+            PutString(out, material.bumpMap);
+            PutString(out, material.alphaMap);
+        }
+        return out;
+    }
+
+    // reads fields off the payload, every Get fails once it would run past the end
+    class PayloadReader {
+    public:
+        PayloadReader(const void* data, uint64_t size)
+            : p(static_cast<const unsigned char*>(data)), end(p + size)
+        {
+        }
+
+        template <typename T>
+        bool Get(T& value)
+        {
+            if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+            std::memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+
+        bool GetString(std::string& text)
+        {
+            uint32_t length = 0;
+            if (!Get(length) || static_cast<size_t>(end - p) < length) return false;
+            text.assign(reinterpret_cast<const char*>(p), length);
+            p += length;
+            return true;
+        }
+
+    private:
+        const unsigned char* p;
+        const unsigned char* end;
+    };
+
+    bool UnpackMaterials(const void* data, uint64_t size, std::vector<MeshMaterial>& materials,
+        std::vector<MaterialLibrary>& libraries)
+    {
+        PayloadReader reader(data, size);
+        uint32_t materialCount = 0, libraryCount = 0;
+        if (!reader.Get(materialCount) || !reader.Get(libraryCount)) return false;
+
+        // every record takes some bytes, so counts beyond the size are corrupt
+        if (materialCount > size || libraryCount > size) return false;
+        libraries.resize(libraryCount);
+        for (MaterialLibrary& library : libraries) {
+            if (!reader.Get(library.size) || !reader.Get(library.modifiedTime) || !reader.GetString(library.path)) return false;
+        }
+        materials.resize(materialCount);
+        for (MeshMaterial& material : materials) {
+            float values[14];
+            if (!reader.Get(values)) return false;
+            material.ambient = glm::vec3(values[0], values[1], values[2]);
+            material.diffuse = glm::vec3(values[3], values[4], values[5]);
+            material.specular = glm::vec3(values[6], values[7], values[8]);
+            material.emissive = glm::vec3(values[9], values[10], values[11]);
+            material.shininess = values[12];
+            material.opacity = values[13];
+            if (!reader.GetString(material.name) || !reader.GetString(material.diffuseMap)
+                || !reader.GetString(material.specularMap) || !reader.GetString(material.bumpMap)
+                || !reader.GetString(material.alphaMap)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool WriteSections(const std::string& path, MeshCacheHeader header, const std::vector<SectionData>& data)
+    {
+        std::vector<MeshCacheSection> table(data.size());
+        uint64_t offset = AlignUp(sizeof(MeshCacheHeader) + data.size() * sizeof(MeshCacheSection));
+        for (size_t i = 0; i < data.size(); ++i) {
+            table[i] = { data[i].id, 0, offset, data[i].size };
+            offset = AlignUp(offset + data[i].size);
+        }
+        header.sectionCount = static_cast<uint32_t>(data.size());
+        header.fileSize = offset;
+        header.checksum = 0;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.good()) return false;
+
+        // stream everything after the header through the hash as it is written
+        Hash64 hash;
+        HashHeader(hash, header);
+        uint64_t written = sizeof(MeshCacheHeader);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        auto emit = [&](const void* bytes, uint64_t size) {
+            if (size == 0) return;
+            hash.Update(bytes, static_cast<size_t>(size));
+            out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+            written += size;
+        };
+        auto pad = [&]() {
+            static const char zeros[kSectionAlignment] = {};
+            emit(zeros, AlignUp(written) - written);
+        };
+
+        emit(table.data(), table.size() * sizeof(MeshCacheSection));
+        for (const SectionData& section : data) {
+            pad();
+            emit(section.data, section.size);
+        }
+        pad();
+
+        // patch the checksum into the header
+        header.checksum = hash.Digest();
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        return !out.fail();
+    }
+}
+
+CacheStatus MeshCache::Reject(const std::string& reason)
+{
+    error = reason;
+    file.Close();
+    sections.clear();
+    materials.clear();
+    materialLibraries.clear();
+    return CacheStatus::Invalid;
+}
+
+CacheStatus MeshCache::Open(const std::string& path)
+{
+    error.clear();
+    sections.clear();
+    materials.clear();
+    materialLibraries.clear();
+    if (!file.Open(path)) return CacheStatus::Missing;
+
+    const char* data = file.Data();
+    const uint64_t size = file.Size();
+    if (size < sizeof(MeshCacheHeader)) {
+        return Reject("truncated header (" + std::to_string(size) + " bytes)");
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) return Reject("not a mesh cache file");
+    if (header.endianTag != kMeshCacheEndianTag) return Reject("written with a different byte order");
+    if (header.version != kMeshCacheVersion) {
+        return Reject("version " + std::to_string(header.version) + ", expected " + std::to_string(kMeshCacheVersion));
+    }
+    if (header.headerSize != sizeof(MeshCacheHeader)) return Reject("unexpected header size");
+    if (header.fileSize != size) {
+        return Reject("size mismatch (" + std::to_string(size) + " bytes, header says " + std::to_string(header.fileSize) + ")");
+    }
+
+    const VertexFormat format = { header.positionFormat, header.uvFormat, header.normalFormat };
+    if (!IsValidVertexFormat(format)) return Reject("unknown vertex layout");
+    layout = MakeVertexLayout(format);
+    if (header.vertexStride != layout.stride) return Reject("vertex layout differs from this build");
+    if (header.indexSize != sizeof(unsigned int) && header.indexSize != sizeof(unsigned short)) {
+        return Reject("unsupported index size");
+    }
+    if (header.indexSize == sizeof(unsigned short) && header.vertexCount > kMaxShortIndexVertices) {
+        return Reject("too many vertices for 16-bit indices");
+    }
+
+    // section table must sit inside the file, and so must every payload
+    const uint64_t tableEnd = sizeof(MeshCacheHeader) + static_cast<uint64_t>(header.sectionCount) * sizeof(MeshCacheSection);
+    if (tableEnd > size) return Reject("truncated section table");
+    sections.resize(header.sectionCount);
+    if (!sections.empty()) {
+        std::memcpy(sections.data(), data + sizeof(MeshCacheHeader), sections.size() * sizeof(MeshCacheSection));
+    }
+    for (const MeshCacheSection& section : sections) {
+        if (section.offset < tableEnd || section.offset > size || section.size > size - section.offset) {
+            return Reject("section out of bounds");
+        }
+    }
+
+    uint64_t sourceBytes = 0;
+    const void* sourceData = Section(kSectionSource, &sourceBytes);
+    if (!sourceData || sourceBytes != sizeof(MeshCacheSource)) return Reject("missing source stamp");
+    std::memcpy(&source, sourceData, sizeof(source));
+
+    uint64_t vertexBytes = 0, indexBytes = 0;
+    if (Section(kSectionVertices, &vertexBytes) && Section(kSectionIndices, &indexBytes)) {
+        encoding = MeshCacheEncoding::Raw;
+        if (vertexBytes != header.vertexCount * header.vertexStride || indexBytes != header.indexCount * header.indexSize) {
+            return Reject("section sizes disagree with header counts");
+        }
+    }
+    else if (Section(kSectionPackedVertices) && Section(kSectionPackedIndices)) {
+        // packed streams are checked against the counts as they decode
+        encoding = MeshCacheEncoding::Packed;
+    }
+    else {
+        return Reject("missing mesh sections");
+    }
+
+    if (!format.IsFloat()) {
+        uint64_t quantizationBytes = 0;
+        const void* quantization = Section(kSectionQuantization, &quantizationBytes);
+        if (!quantization || quantizationBytes != sizeof(VertexQuantization)) return Reject("missing vertex quantization");
+        std::memcpy(&layout.quantization, quantization, sizeof(VertexQuantization));
+    }
+
+    uint64_t lodBytes = 0;
+    const void* lodData = Section(kSectionLods, &lodBytes);
+    if (lodData) {
+        if (lodBytes % sizeof(MeshLod) != 0) return Reject("bad lod table size");
+        for (uint64_t offset = 0; offset < lodBytes; offset += sizeof(MeshLod)) {
+            MeshLod lod;
+            std::memcpy(&lod, static_cast<const unsigned char*>(lodData) + offset, sizeof(lod));
+            if (static_cast<uint64_t>(lod.indexOffset) + lod.indexCount > header.indexCount) {
+                return Reject("lod range out of bounds");
+            }
+        }
+    }
+
+    uint64_t meshletBytes = 0;
+    const void* meshletData = Section(kSectionMeshlets, &meshletBytes);
+    if (meshletData) {
+        if (meshletBytes % sizeof(Meshlet) != 0) return Reject("bad meshlet table size");
+        for (uint64_t offset = 0; offset < meshletBytes; offset += sizeof(Meshlet)) {
+            Meshlet meshlet;
+            std::memcpy(&meshlet, static_cast<const unsigned char*>(meshletData) + offset, sizeof(meshlet));
+            if (static_cast<uint64_t>(meshlet.indexOffset) + static_cast<uint64_t>(meshlet.triangleCount) * 3 > header.indexCount) {
+                return Reject("meshlet range out of bounds");
+            }
+        }
+    }
+
+    uint64_t materialBytes = 0;
+    const void* materialData = Section(kSectionMaterials, &materialBytes);
+    if (materialData && !UnpackMaterials(materialData, materialBytes, materials, materialLibraries)) {
+        return Reject("bad material section");
+    }
+
+    uint64_t submeshBytes = 0;
+    const void* submeshData = Section(kSectionSubmeshes, &submeshBytes);
+    if (submeshData) {
+        if (submeshBytes % sizeof(MeshSubmesh) != 0) return Reject("bad submesh table size");
+        for (uint64_t offset = 0; offset < submeshBytes; offset += sizeof(MeshSubmesh)) {
+            MeshSubmesh submesh;
+            std::memcpy(&submesh, static_cast<const unsigned char*>(submeshData) + offset, sizeof(submesh));
+            if (static_cast<uint64_t>(submesh.indexOffset) + submesh.indexCount > header.indexCount) {
+                return Reject("submesh range out of bounds");
+            }
+            if (submesh.material >= materials.size()) return Reject("submesh material out of range");
+        }
+    }
+
+    Hash64 hash;
+    HashHeader(hash, header);
+    hash.Update(data + sizeof(MeshCacheHeader), static_cast<size_t>(size - sizeof(MeshCacheHeader)));
+    if (hash.Digest() != header.checksum) return Reject("checksum mismatch");
+
+    // raw indices go to the renderer straight from the mapping, packed ones
+    // are checked by Read once decoded
+    size_t highest = 0;
+    if (encoding == MeshCacheEncoding::Raw && !IndicesInRange(Section(kSectionIndices), static_cast<size_t>(header.indexCount),
+        header.indexSize, static_cast<size_t>(header.vertexCount), highest)) {
+        return Reject(IndexRangeError(highest, static_cast<size_t>(header.vertexCount)));
+    }
+    return CacheStatus::Ok;
+}
+
+const void* MeshCache::Section(uint32_t id, uint64_t* size) const
+{
+    for (const MeshCacheSection& section : sections) {
+        if (section.id == id) {
+            if (size) *size = section.size;
+            return file.Data() + section.offset;
+        }
+    }
+    return nullptr;
+}
+
+MeshView MeshCache::View() const
+{
+    MeshView view;
+    if (!file.IsOpen() || encoding != MeshCacheEncoding::Raw) return view;
+    if (layout.format.IsFloat()) {
+        view.vertices = static_cast<const Vertex*>(Section(kSectionVertices));
+    }
+    else {
+        view.quantizedVertices = static_cast<const unsigned char*>(Section(kSectionVertices));
+    }
+    view.layout = layout;
+    view.vertexCount = static_cast<size_t>(header.vertexCount);
+    view.indices = Section(kSectionIndices);
+    view.indexCount = static_cast<size_t>(header.indexCount);
+    view.indexSize = header.indexSize;
+    uint64_t lodBytes = 0;
+    view.lods = static_cast<const MeshLod*>(Section(kSectionLods, &lodBytes));
+    view.lodCount = static_cast<size_t>(lodBytes / sizeof(MeshLod));
+    uint64_t meshletBytes = 0;
+    view.meshlets = static_cast<const Meshlet*>(Section(kSectionMeshlets, &meshletBytes));
+    view.meshletCount = static_cast<size_t>(meshletBytes / sizeof(Meshlet));
+    uint64_t submeshBytes = 0;
+    view.submeshes = static_cast<const MeshSubmesh*>(Section(kSectionSubmeshes, &submeshBytes));
+    view.submeshCount = static_cast<size_t>(submeshBytes / sizeof(MeshSubmesh));
+    view.materials = materials.data();
+    view.materialCount = materials.size();
+    view.materialLibraries = materialLibraries.data();
+    view.materialLibraryCount = materialLibraries.size();
+    return view;
+}
+
+CacheStatus MeshCache::Read(Mesh& mesh)
+{
+    if (!file.IsOpen()) return CacheStatus::Missing;
+    const size_t vertexCount = static_cast<size_t>(header.vertexCount);
+    mesh.layout = layout;
+    mesh.vertices.clear();
+    mesh.quantizedVertices.clear();
+    if (layout.format.IsFloat()) {
+        mesh.vertices.resize(vertexCount);
+    }
+    else {
+        mesh.quantizedVertices.resize(vertexCount * layout.stride);
+    }
+    void* vertexData = layout.format.IsFloat() ? static_cast<void*>(mesh.vertices.data()) : mesh.quantizedVertices.data();
+    const bool shortIndices = header.indexSize == sizeof(unsigned short);
+    mesh.indices.clear();
+    mesh.shortIndices.clear();
+    if (shortIndices) {
+        mesh.shortIndices.resize(static_cast<size_t>(header.indexCount));
+    }
+    else {
+        mesh.indices.resize(static_cast<size_t>(header.indexCount));
+    }
+
+    uint64_t lodBytes = 0;
+    const void* lodData = Section(kSectionLods, &lodBytes);
+    mesh.lods.resize(static_cast<size_t>(lodBytes / sizeof(MeshLod)));
+    if (!mesh.lods.empty()) std::memcpy(mesh.lods.data(), lodData, mesh.lods.size() * sizeof(MeshLod));
+
+    uint64_t meshletBytes = 0;
+    const void* meshletData = Section(kSectionMeshlets, &meshletBytes);
+    mesh.meshlets.resize(static_cast<size_t>(meshletBytes / sizeof(Meshlet)));
+    if (!mesh.meshlets.empty()) std::memcpy(mesh.meshlets.data(), meshletData, mesh.meshlets.size() * sizeof(Meshlet));
+
+    uint64_t submeshBytes = 0;
+    const void* submeshData = Section(kSectionSubmeshes, &submeshBytes);
+    mesh.submeshes.resize(static_cast<size_t>(submeshBytes / sizeof(MeshSubmesh)));
+    if (!mesh.submeshes.empty()) std::memcpy(mesh.submeshes.data(), submeshData, mesh.submeshes.size() * sizeof(MeshSubmesh));
+    mesh.materials = materials;
+    mesh.materialLibraries = materialLibraries;
+
+    if (encoding == MeshCacheEncoding::Packed) {
+        uint64_t vertexBytes = 0, indexBytes = 0;
+        const void* packedVertices = Section(kSectionPackedVertices, &vertexBytes);
+        const void* packedIndices = Section(kSectionPackedIndices, &indexBytes);
+        if (!UnpackVertices(packedVertices, static_cast<size_t>(vertexBytes), vertexData, vertexCount, layout.stride)) {
+            return Reject("malformed packed vertices");
+        }
+        const bool unpacked = shortIndices
+            ? UnpackIndices(packedIndices, static_cast<size_t>(indexBytes), mesh.shortIndices.data(), mesh.shortIndices.size())
+            : UnpackIndices(packedIndices, static_cast<size_t>(indexBytes), mesh.indices.data(), mesh.indices.size());
+        if (!unpacked) return Reject("malformed packed indices");
+
+        size_t highest = 0;
+        const void* indexData = shortIndices ? static_cast<const void*>(mesh.shortIndices.data()) : mesh.indices.data();
+        if (!IndicesInRange(indexData, static_cast<size_t>(header.indexCount), header.indexSize, vertexCount, highest)) {
+            return Reject(IndexRangeError(highest, vertexCount));
+        }
+    }
+    else {
+        if (vertexCount > 0) std::memcpy(vertexData, Section(kSectionVertices), vertexCount * layout.stride);
+        void* indexData = shortIndices ? static_cast<void*>(mesh.shortIndices.data()) : mesh.indices.data();
+        if (header.indexCount > 0) std::memcpy(indexData, Section(kSectionIndices), static_cast<size_t>(header.indexCount) * header.indexSize);
+    }
+    return CacheStatus::Ok;
+}
+
+bool MeshCache::Write(const std::string& path, const MeshCacheSource& source, const MeshView& mesh,
+    MeshCacheEncoding encoding)
+{
+    MeshCacheHeader header = MakeHeader(mesh.layout, mesh.indexSize);
+    header.vertexCount = mesh.vertexCount;
+    header.indexCount = mesh.indexCount;
+    const bool compact = !mesh.layout.format.IsFloat();
+    const void* vertexData = compact ? static_cast<const void*>(mesh.quantizedVertices) : mesh.vertices;
+
+    std::vector<SectionData> data = { { kSectionSource, &source, sizeof(MeshCacheSource) } };
+    std::vector<unsigned char> packedVertices, packedIndices;
+    if (encoding == MeshCacheEncoding::Packed) {
+        packedVertices = PackVertices(vertexData, mesh.vertexCount, mesh.layout.stride);
+        packedIndices = mesh.indexSize == sizeof(unsigned short)
+            ? PackIndices(static_cast<const unsigned short*>(mesh.indices), mesh.indexCount)
+            : PackIndices(static_cast<const unsigned int*>(mesh.indices), mesh.indexCount);
+        data.push_back({ kSectionPackedVertices, packedVertices.data(), packedVertices.size() });
+        data.push_back({ kSectionPackedIndices, packedIndices.data(), packedIndices.size() });
+    }
+    else {
+        data.push_back({ kSectionVertices, vertexData, mesh.vertexCount * mesh.layout.stride });
+        data.push_back({ kSectionIndices, mesh.indices, mesh.indexCount * mesh.indexSize });
+    }
+    if (compact) data.push_back({ kSectionQuantization, &mesh.layout.quantization, sizeof(VertexQuantization) });
+    if (mesh.lodCount > 0) data.push_back({ kSectionLods, mesh.lods, mesh.lodCount * sizeof(MeshLod) });
+    if (mesh.meshletCount > 0) data.push_back({ kSectionMeshlets, mesh.meshlets, mesh.meshletCount * sizeof(Meshlet) });
+    if (mesh.submeshCount > 0) data.push_back({ kSectionSubmeshes, mesh.submeshes, mesh.submeshCount * sizeof(MeshSubmesh) });
+    std::vector<unsigned char> packedMaterials;
+    if (mesh.materialCount > 0 || mesh.materialLibraryCount > 0) {
+        packedMaterials = PackMaterials(mesh);
+        data.push_back({ kSectionMaterials, packedMaterials.data(), packedMaterials.size() });
+    }
+    return WriteSections(path, header, data);
+}
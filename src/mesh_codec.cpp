@@ -0,0 +1,190 @@
+#include "../include/mesh_codec.h"
+#include "../include/lz_codec.h"
+#include <cstring>
+#include <type_traits>
+
+namespace {
+    // raw bytes per lz block, small enough that 32-bit positions and the
+    // 64 KB window cover it comfortably, large enough to amortise headers
+    constexpr uint32_t kBlockSize = 1u << 20;
+
+    // set in a block's size entry when lz did not help and the block is stored raw
+    constexpr uint32_t kStoredBlock = 0x80000000u;
+
+    // out[k * count + i] = in[i * width + k]
+    void ToPlanes(const unsigned char* in, size_t count, size_t width, unsigned char* out)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const unsigned char* record = in + i * width;
+            for (size_t k = 0; k < width; ++k) out[k * count + i] = record[k];
+        }
+    }
+
+    void FromPlanes(const unsigned char* in, size_t count, size_t width, unsigned char* out)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            unsigned char* record = out + i * width;
+            for (size_t k = 0; k < width; ++k) record[k] = in[k * count + i];
+        }
+    }
+
+    // T is the unsigned index type, deltas wrap at its width
+    template <typename T>
+    inline T Zigzag(T delta)
+    {
+        using Signed = typename std::make_signed<T>::type;
+        const T sign = static_cast<T>(static_cast<Signed>(delta) >> (sizeof(T) * 8 - 1));
+        return static_cast<T>(static_cast<T>(delta << 1) ^ sign);
+    }
+
+    template <typename T>
+    inline T Unzigzag(T value)
+    {
+        return static_cast<T>((value >> 1) ^ static_cast<T>(0u - (value & 1u)));
+    }
+
+    std::vector<unsigned char> Pack(const unsigned char* filtered, size_t size, StreamFilter filter)
+    {
+        PackedStreamHeader header{};
+        header.rawSize = size;
+        header.filter = filter;
+        header.blockSize = kBlockSize;
+        header.blockCount = static_cast<uint32_t>((size + kBlockSize - 1) / kBlockSize);
+
+        const size_t tableBytes = header.blockCount * sizeof(uint32_t);
+        std::vector<unsigned char> out(sizeof(header) + tableBytes + LzBound(kBlockSize));
+        std::memcpy(out.data(), &header, sizeof(header));
+
+        size_t used = sizeof(header) + tableBytes;
+        for (uint32_t block = 0; block < header.blockCount; ++block) {
+            const size_t offset = static_cast<size_t>(block) * kBlockSize;
+            const size_t length = (size - offset < kBlockSize) ? size - offset : kBlockSize;
+            if (out.size() < used + LzBound(length)) out.resize(used + LzBound(length));
+
+            uint32_t packed = static_cast<uint32_t>(LzCompress(filtered + offset, length, out.data() + used));
+            uint32_t entry = packed;
+            if (packed >= length) {
+                std::memcpy(out.data() + used, filtered + offset, length);
+                packed = static_cast<uint32_t>(length);
+                entry = packed | kStoredBlock;
+            }
+            std::memcpy(out.data() + sizeof(header) + block * sizeof(uint32_t), &entry, sizeof(entry));
+            used += packed;
+        }
+        out.resize(used);
+        return out;
+    }
+
+    // decode a packed stream of the given filter and raw size into out
+    bool Unpack(const void* packed, size_t size, StreamFilter filter, unsigned char* out, size_t rawSize)
+    {
+        const unsigned char* data = static_cast<const unsigned char*>(packed);
+        PackedStreamHeader header;
+        if (size < sizeof(header)) return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.filter != filter || header.rawSize != rawSize || header.blockSize == 0) return false;
+        if (header.blockCount != (rawSize + header.blockSize - 1) / header.blockSize) return false;
+
+        const size_t tableBytes = static_cast<size_t>(header.blockCount) * sizeof(uint32_t);
+        if (size - sizeof(header) < tableBytes) return false;
+        const unsigned char* table = data + sizeof(header);
+        const unsigned char* block = table + tableBytes;
+        const unsigned char* end = data + size;
+
+        for (uint32_t i = 0; i < header.blockCount; ++i) {
+            uint32_t entry;
+            std::memcpy(&entry, table + i * sizeof(uint32_t), sizeof(entry));
+            const uint32_t packedSize = entry & ~kStoredBlock;
+            if (packedSize > static_cast<size_t>(end - block)) return false;
+
+            const size_t offset = static_cast<size_t>(i) * header.blockSize;
+            const size_t length = (rawSize - offset < header.blockSize) ? rawSize - offset : header.blockSize;
+            if (entry & kStoredBlock) {
+                if (packedSize != length) return false;
+                std::memcpy(out + offset, block, length);
+            }
+            else if (!LzDecompress(block, packedSize, out + offset, length)) {
+                return false;
+            }
+            block += packedSize;
+        }
+        return block == end;
+    }
+
+    // zigzag deltas of T-sized indices, shuffled into sizeof(T) planes
+    template <typename T>
+    std::vector<unsigned char> PackDeltas(const T* indices, size_t count)
+    {
+        std::vector<T> deltas(count);
+        T previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            deltas[i] = Zigzag<T>(static_cast<T>(indices[i] - previous));
+            previous = indices[i];
+        }
+
+        std::vector<unsigned char> planes(count * sizeof(T));
+        ToPlanes(reinterpret_cast<const unsigned char*>(deltas.data()), count, sizeof(T), planes.data());
+        return Pack(planes.data(), planes.size(), StreamFilter::IndexDelta);
+    }
+
+    template <typename T>
+    bool UnpackDeltas(const void* packed, size_t size, T* out, size_t count)
+    {
+        std::vector<unsigned char> planes(count * sizeof(T));
+        if (!Unpack(packed, size, StreamFilter::IndexDelta, planes.data(), planes.size())) return false;
+        FromPlanes(planes.data(), count, sizeof(T), reinterpret_cast<unsigned char*>(out));
+
+        T previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            previous = static_cast<T>(previous + Unzigzag<T>(out[i]));
+            out[i] = previous;
+        }
+        return true;
+    }
+}
+
+std::vector<unsigned char> PackVertices(const Vertex* vertices, size_t count)
+{
+    return PackVertices(static_cast<const void*>(vertices), count, sizeof(Vertex));
+}
+
+std::vector<unsigned char> PackVertices(const void* vertices, size_t count, size_t stride)
+{
+    std::vector<unsigned char> planes(count * stride);
+    ToPlanes(static_cast<const unsigned char*>(vertices), count, stride, planes.data());
+    return Pack(planes.data(), planes.size(), StreamFilter::VertexPlanes);
+}
+
+std::vector<unsigned char> PackIndices(const unsigned short* indices, size_t count)
+{
+    return PackDeltas(indices, count);
+}
+
+std::vector<unsigned char> PackIndices(const unsigned int* indices, size_t count)
+{
+    static_assert(sizeof(unsigned int) == sizeof(uint32_t), "indices are stored as 32-bit values");
+    return PackDeltas(indices, count);
+}
+
+bool UnpackVertices(const void* packed, size_t size, Vertex* out, size_t count)
+{
+    return UnpackVertices(packed, size, static_cast<void*>(out), count, sizeof(Vertex));
+}
+
+bool UnpackVertices(const void* packed, size_t size, void* out, size_t count, size_t stride)
+{
+    std::vector<unsigned char> planes(count * stride);
+    if (!Unpack(packed, size, StreamFilter::VertexPlanes, planes.data(), planes.size())) return false;
+    FromPlanes(planes.data(), count, stride, static_cast<unsigned char*>(out));
+    return true;
+}
+
+bool UnpackIndices(const void* packed, size_t size, unsigned short* out, size_t count)
+{
+    return UnpackDeltas(packed, size, out, count);
+}
+
+bool UnpackIndices(const void* packed, size_t size, unsigned int* out, size_t count)
+{
+    return UnpackDeltas(packed, size, out, count);
+}
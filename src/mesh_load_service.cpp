@@ -0,0 +1,81 @@
+#include "../include/mesh_load_service.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    bool IsReady(const std::future<void>& future)
+    {
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+}
+
+// one worker is enough, a load parallelises its own parse
+MeshLoadService::MeshLoadService()
+    : pool(1)
+{
+}
+
+MeshLoadService::~MeshLoadService()
+{
+    // the pool drains queued jobs before it stops, make them quick
+    Cancel();
+    for (auto& job : retired) job->progress.Cancel();
+}
+
+void MeshLoadService::Request(const std::string& path)
+{
+    Cancel();
+
+    auto job = std::make_unique<Job>();
+    job->path = path;
+    job->loader = std::make_unique<Loader>();
+    job->loader->progress = &job->progress;
+    job->loader->optimizeVertexCache = optimizeMeshes;
+    job->loader->optimizeOverdraw = optimizeMeshes;
+    job->loader->optimizeVertexFetch = optimizeMeshes;
+    job->loader->lodCount = lodCount;
+    job->loader->buildMeshlets = buildMeshlets;
+    job->loader->narrowIndices = narrowIndices;
+    if (compactVertices) job->loader->vertexFormat = kCompactVertexFormat;
+
+    Loader* loader = job->loader.get();
+    job->done = pool.Submit([loader, path]() { loader->GetVertices(path); });
+    current = std::move(job);
+}
+
+void MeshLoadService::Cancel()
+{
+    if (!current) return;
+    current->progress.Cancel();
+    retired.push_back(std::move(current));
+}
+
+const std::string& MeshLoadService::PendingPath() const
+{
+    static const std::string none;
+    return current ? current->path : none;
+}
+
+float MeshLoadService::Progress() const
+{
+    return current ? current->progress.Fraction() : 0.0f;
+}
+
+bool MeshLoadService::Poll(std::string& path, std::unique_ptr<Loader>& loader)
+{
+    Reap();
+    if (!current || !IsReady(current->done)) return false;
+
+    std::unique_ptr<Job> job = std::move(current);
+    job->done.get();
+    job->loader->progress = nullptr;
+    path = job->path;
+    loader = std::move(job->loader);
+    return true;
+}
+
+void MeshLoadService::Reap()
+{
+    retired.erase(std::remove_if(retired.begin(), retired.end(),
+        [](const std::unique_ptr<Job>& job) { return IsReady(job->done); }), retired.end());
+}
@@ -0,0 +1,453 @@
+#include "../include/mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+    // scoring parameters from forsyth's paper
+    constexpr int kCacheSize = 32;
+    constexpr int kMaxValence = 32;
+    constexpr float kCacheDecayPower = 1.5f;
+    constexpr float kLastTriangleScore = 0.75f;
+    constexpr float kValenceBoostScale = 2.0f;
+    constexpr float kValenceBoostPower = 0.5f;
+
+    struct ScoreTables {
+        float cache[kCacheSize];
+        float valence[kMaxValence + 1];
+
+        ScoreTables()
+        {
+            // the last triangle's vertices score the same on purpose, so the
+            // next one does not just continue a strip in one direction
+            for (int i = 0; i < kCacheSize; ++i) {
+                if (i < 3) {
+                    cache[i] = kLastTriangleScore;
+                }
+                else {
+                    const float scaler = 1.0f - static_cast<float>(i - 3) / (kCacheSize - 3);
+                    cache[i] = std::pow(scaler, kCacheDecayPower);
+                }
+            }
+            // vertices with few triangles left get a boost to finish them off
+            valence[0] = 0.0f;
+            for (int i = 1; i <= kMaxValence; ++i) {
+                valence[i] = kValenceBoostScale * std::pow(static_cast<float>(i), -kValenceBoostPower);
+            }
+        }
+    };
+
+    const ScoreTables& Tables()
+    {
+        static const ScoreTables tables;
+        return tables;
+    }
+
+    // grid the overdraw analyzer rasterises into, per view
+    constexpr int kOverdrawGrid = 256;
+
+    inline const float* Position(const float* positions, size_t stride, unsigned int v)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + static_cast<size_t>(v) * stride);
+    }
+
+    // fifo cache simulation, an entry is cached while fewer than size misses
+    // came after its own. Touch returns 1 on a miss
+    struct FifoCache {
+        std::vector<size_t> loadedAt;
+        size_t misses;
+        unsigned int size;
+
+        FifoCache(size_t vertexCount, unsigned int cacheSize)
+            : loadedAt(vertexCount, 0), misses(cacheSize + 1), size(cacheSize)
+        {
+        }
+
+        // forget everything cached so far
+        void Flush() { misses += size + 1; }
+
+        unsigned int Touch(unsigned int v)
+        {
+            if (misses - loadedAt[v] <= size) return 0;
+            loadedAt[v] = misses++;
+            return 1;
+        }
+    };
+
+    inline float VertexScore(int cachePosition, unsigned int liveTriangles)
+    {
+        if (liveTriangles == 0) return -1.0f;
+        const ScoreTables& tables = Tables();
+        float score = tables.valence[std::min<unsigned int>(liveTriangles, kMaxValence)];
+        if (cachePosition >= 0) score += tables.cache[cachePosition];
+        return score;
+    }
+}
+
+template <typename Index>
+VertexCacheStats AnalyzeVertexCache(const Index* indices, size_t indexCount, size_t vertexCount,
+    unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangles = indexCount / 3;
+    stats.vertices = vertexCount;
+
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indices[i] < vertexCount) stats.vertexTransforms += cache.Touch(indices[i]);
+    }
+
+    if (stats.triangles > 0) stats.acmr = static_cast<float>(stats.vertexTransforms) / stats.triangles;
+    if (stats.vertices > 0) stats.atvr = static_cast<float>(stats.vertexTransforms) / stats.vertices;
+    return stats;
+}
+
+template <typename Index>
+void OptimizeVertexCache(Index* destination, const Index* indices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    // work from a copy so destination may alias indices
+    const std::vector<unsigned int> source(indices, indices + triangleCount * 3);
+
+    // triangles using each vertex, as ranges into one array. the live part of
+    // a range shrinks as its triangles are emitted
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int v : source) ++liveTriangles[v];
+    std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) firstTriangle[v + 1] = firstTriangle[v] + liveTriangles[v];
+    std::vector<unsigned int> adjacency(firstTriangle[vertexCount]);
+    {
+        std::vector<size_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int k = 0; k < 3; ++k) adjacency[fill[source[t * 3 + k]]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = VertexScore(-1, liveTriangles[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[source[t * 3]] + vertexScore[source[t * 3 + 1]] + vertexScore[source[t * 3 + 2]];
+    }
+
+    // room for the cache plus the three vertices pushed in front of it
+    unsigned int cache[kCacheSize + 3];
+    int cacheCount = 0;
+
+    size_t best = 0;
+    float bestScore = triangleScore[0];
+    for (size_t t = 1; t < triangleCount; ++t) {
+        if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            best = t;
+        }
+    }
+
+    size_t cursor = 0;      // no emitted triangles before it, for dead ends
+    size_t output = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (best == SIZE_MAX) {
+            // nothing in the cache touches a live triangle, start a new island
+            while (emitted[cursor]) ++cursor;
+            best = cursor;
+        }
+
+        const unsigned int* triangle = &source[best * 3];
+        emitted[best] = 1;
+        for (int k = 0; k < 3; ++k) destination[output++] = static_cast<Index>(triangle[k]);
+
+        // drop the triangle from its vertices' live ranges
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = triangle[k];
+            unsigned int* begin = &adjacency[firstTriangle[v]];
+            unsigned int* end = begin + liveTriangles[v];
+            unsigned int* found = std::find(begin, end, static_cast<unsigned int>(best));
+            std::swap(*found, *(end - 1));
+            --liveTriangles[v];
+        }
+
+        // move the triangle's vertices to the front of the lru cache
+        unsigned int next[kCacheSize + 3];
+        int nextCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (std::find(next, next + nextCount, triangle[k]) == next + nextCount) next[nextCount++] = triangle[k];
+        }
+        for (int i = 0; i < cacheCount; ++i) {
+            const unsigned int v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) next[nextCount++] = v;
+        }
+
+        // rescore everything that was or is in the cache and the triangles
+        // around it
+        for (int i = 0; i < nextCount; ++i) {
+            const unsigned int v = next[i];
+            cachePosition[v] = i < kCacheSize ? i : -1;
+            const float score = VertexScore(cachePosition[v], liveTriangles[v]);
+            const float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            const unsigned int* live = &adjacency[firstTriangle[v]];
+            for (unsigned int j = 0; j < liveTriangles[v]; ++j) triangleScore[live[j]] += delta;
+        }
+
+        // the next triangle is the best one touching the cache
+        best = SIZE_MAX;
+        bestScore = -1.0f;
+        for (int i = 0; i < std::min(nextCount, kCacheSize); ++i) {
+            const unsigned int v = next[i];
+            const unsigned int* live = &adjacency[firstTriangle[v]];
+            for (unsigned int j = 0; j < liveTriangles[v]; ++j) {
+                if (triangleScore[live[j]] > bestScore) {
+                    bestScore = triangleScore[live[j]];
+                    best = live[j];
+                }
+            }
+        }
+
+        cacheCount = std::min(nextCount, kCacheSize);
+        std::copy(next, next + cacheCount, cache);
+    }
+}
+
+template <typename Index>
+VertexFetchStats AnalyzeVertexFetch(const Index* indices, size_t indexCount, size_t vertexCount,
+    size_t vertexSize)
+{
+    VertexFetchStats stats;
+    const size_t bufferSize = vertexCount * vertexSize;
+    if (bufferSize == 0) return stats;
+
+    // only post-transform cache misses load anything
+    FifoCache vertexCache(vertexCount, kDefaultVertexCacheSize);
+    FifoCache lineCache((bufferSize + kFetchLineSize - 1) / kFetchLineSize, kFetchCacheLines);
+    for (size_t i = 0; i < indexCount; ++i) {
+        const unsigned int v = indices[i];
+        if (v >= vertexCount || !vertexCache.Touch(v)) continue;
+
+        const size_t first = v * vertexSize / kFetchLineSize;
+        const size_t last = ((v + 1) * vertexSize - 1) / kFetchLineSize;
+        for (size_t line = first; line <= last; ++line) {
+            stats.bytesFetched += lineCache.Touch(static_cast<unsigned int>(line)) * kFetchLineSize;
+        }
+    }
+    stats.overfetch = static_cast<float>(static_cast<double>(stats.bytesFetched) / bufferSize);
+    return stats;
+}
+
+template <typename Index>
+size_t OptimizeVertexFetch(void* destination, Index* indices, size_t indexCount,
+    const void* vertices, size_t vertexCount, size_t vertexSize)
+{
+    constexpr unsigned int kUnused = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(vertexCount, kUnused);
+
+    unsigned int next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        unsigned int& slot = remap[indices[i]];
+        if (slot == kUnused) {
+            std::memcpy(static_cast<char*>(destination) + static_cast<size_t>(next) * vertexSize,
+                static_cast<const char*>(vertices) + static_cast<size_t>(indices[i]) * vertexSize, vertexSize);
+            slot = next++;
+        }
+        indices[i] = static_cast<Index>(slot);
+    }
+    return next;
+}
+
+template <typename Index>
+OverdrawStats AnalyzeOverdraw(const Index* indices, size_t indexCount, const float* positions,
+    size_t vertexCount, size_t stride)
+{
+    OverdrawStats stats;
+    if (vertexCount == 0 || indexCount < 3) return stats;
+
+    float lo[3], hi[3];
+    for (int k = 0; k < 3; ++k) lo[k] = hi[k] = Position(positions, stride, 0)[k];
+    for (size_t v = 1; v < vertexCount; ++v) {
+        const float* p = Position(positions, stride, static_cast<unsigned int>(v));
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], p[k]);
+            hi[k] = std::max(hi[k], p[k]);
+        }
+    }
+    const float extent = std::max({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] });
+    const float scale = extent > 0.0f ? (kOverdrawGrid - 1) / extent : 0.0f;
+
+    std::vector<float> depth(kOverdrawGrid * kOverdrawGrid);
+    for (int view = 0; view < 6; ++view) {
+        // look down one axis, from either side
+        const int axis = view / 2;
+        const float sign = (view & 1) ? -1.0f : 1.0f;
+        const int uAxis = (axis + 1) % 3, vAxis = (axis + 2) % 3;
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            float x[3], y[3], z[3];
+            for (int k = 0; k < 3; ++k) {
+                const float* p = Position(positions, stride, indices[i + k]);
+                x[k] = (p[uAxis] - lo[uAxis]) * scale;
+                y[k] = (p[vAxis] - lo[vAxis]) * scale;
+                z[k] = sign * p[axis];
+            }
+            // counter-clockwise is front facing, as in gl, and back faces are
+            // culled. the viewer looks down +axis for sign 1, -axis otherwise
+            const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (sign * area >= 0.0f) continue;
+
+            const int minX = std::max(0, static_cast<int>(std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f)));
+            const int maxX = std::min(kOverdrawGrid - 1, static_cast<int>(std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f)));
+            const int minY = std::max(0, static_cast<int>(std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f)));
+            const int maxY = std::min(kOverdrawGrid - 1, static_cast<int>(std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f)));
+            const float inverseArea = 1.0f / area;
+
+            // pixel centres inside the triangle
+            for (int py = minY; py <= maxY; ++py) {
+                const float cy = py + 0.5f;
+                for (int px = minX; px <= maxX; ++px) {
+                    const float cx = px + 0.5f;
+                    const float w0 = ((x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1])) * inverseArea;
+                    const float w1 = ((x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2])) * inverseArea;
+                    const float w2 = 1.0f - w0 - w1;
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                    const float fragment = w0 * z[0] + w1 * z[1] + w2 * z[2];
+                    float& stored = depth[py * kOverdrawGrid + px];
+                    if (fragment < stored) {
+                        stored = fragment;
+                        ++stats.pixelsShaded;
+                    }
+                }
+            }
+        }
+
+        for (float d : depth) {
+            if (d != std::numeric_limits<float>::infinity()) ++stats.pixelsCovered;
+        }
+    }
+
+    if (stats.pixelsCovered > 0) {
+        stats.overdraw = static_cast<float>(static_cast<double>(stats.pixelsShaded) / stats.pixelsCovered);
+    }
+    return stats;
+}
+
+template <typename Index>
+void OptimizeOverdraw(Index* destination, const Index* indices, size_t indexCount,
+    const float* positions, size_t vertexCount, size_t stride, float threshold)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+    const std::vector<unsigned int> source(indices, indices + triangleCount * 3);
+
+    FifoCache cache(vertexCount, kDefaultVertexCacheSize);
+    auto touchTriangle = [&](size_t t) {
+        return cache.Touch(source[t * 3]) + cache.Touch(source[t * 3 + 1]) + cache.Touch(source[t * 3 + 2]);
+    };
+
+    // hard boundaries: triangles that miss on all three vertices, where the
+    // vertex cache order already starts over
+    std::vector<size_t> hard;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (touchTriangle(t) == 3 || t == 0) hard.push_back(t);
+    }
+    hard.push_back(triangleCount);
+
+    // soft boundaries: split a hard cluster again wherever the part so far,
+    // drawn from a cold cache, is within threshold of the cluster's own acmr
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); ++h) {
+        const size_t start = hard[h], end = hard[h + 1];
+        cache.Flush();
+        size_t clusterMisses = 0;
+        for (size_t t = start; t < end; ++t) clusterMisses += touchTriangle(t);
+        const float target = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+        cache.Flush();
+        clusters.push_back(start);
+        size_t misses = 0;
+        for (size_t t = start; t < end; ++t) {
+            misses += touchTriangle(t);
+            if (t + 1 < end && static_cast<float>(misses) <= target * static_cast<float>(t + 1 - clusters.back())) {
+                clusters.push_back(t + 1);
+                misses = 0;
+                cache.Flush();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+    const size_t clusterCount = clusters.size() - 1;
+
+    // area weighted centroid and normal of the mesh and of every cluster
+    std::vector<float> centroids(clusterCount * 3, 0.0f), normals(clusterCount * 3, 0.0f);
+    double meshCentroid[3] = {};
+    double meshArea = 0.0;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const float* a = Position(positions, stride, source[t * 3]);
+            const float* b = Position(positions, stride, source[t * 3 + 1]);
+            const float* d = Position(positions, stride, source[t * 3 + 2]);
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k) {
+                centroids[c * 3 + k] += (a[k] + b[k] + d[k]) / 3.0f * triangleArea;
+                normals[c * 3 + k] += n[k];
+            }
+            area += triangleArea;
+        }
+        for (int k = 0; k < 3; ++k) meshCentroid[k] += centroids[c * 3 + k];
+        meshArea += area;
+        if (area > 0.0f) {
+            for (int k = 0; k < 3; ++k) centroids[c * 3 + k] /= area;
+        }
+    }
+    if (meshArea > 0.0) {
+        for (double& k : meshCentroid) k /= meshArea;
+    }
+
+    // clusters facing away from the centre tend to hide the rest, draw them first
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        const float* n = &normals[c * 3];
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        float key = 0.0f;
+        if (length > 0.0f) {
+            for (int k = 0; k < 3; ++k) key += (centroids[c * 3 + k] - static_cast<float>(meshCentroid[k])) * n[k] / length;
+        }
+        sortKey[c] = key;
+    }
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    size_t output = 0;
+    for (size_t c : order) {
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            for (int k = 0; k < 3; ++k) destination[output++] = static_cast<Index>(source[t * 3 + k]);
+        }
+    }
+}
+
+template VertexCacheStats AnalyzeVertexCache(const unsigned short*, size_t, size_t, unsigned int);
+template VertexCacheStats AnalyzeVertexCache(const unsigned int*, size_t, size_t, unsigned int);
+template void OptimizeVertexCache(unsigned short*, const unsigned short*, size_t, size_t);
+template void OptimizeVertexCache(unsigned int*, const unsigned int*, size_t, size_t);
+template VertexFetchStats AnalyzeVertexFetch(const unsigned short*, size_t, size_t, size_t);
+template VertexFetchStats AnalyzeVertexFetch(const unsigned int*, size_t, size_t, size_t);
+template size_t OptimizeVertexFetch(void*, unsigned short*, size_t, const void*, size_t, size_t);
+template size_t OptimizeVertexFetch(void*, unsigned int*, size_t, const void*, size_t, size_t);
+template OverdrawStats AnalyzeOverdraw(const unsigned short*, size_t, const float*, size_t, size_t);
+template OverdrawStats AnalyzeOverdraw(const unsigned int*, size_t, const float*, size_t, size_t);
+template void OptimizeOverdraw(unsigned short*, const unsigned short*, size_t, const float*, size_t, size_t, float);
+template void OptimizeOverdraw(unsigned int*, const unsigned int*, size_t, const float*, size_t, size_t, float);
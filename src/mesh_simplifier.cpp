@@ -0,0 +1,357 @@
+#include "../include/mesh_simplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+    // border and seam planes count this much more than surface planes
+    constexpr double kEdgeWeight = 10.0;
+
+    // a collapse may turn a triangle at most this far (cosine)
+    constexpr double kMinFaceCosine = 0.25;
+
+    // and a vertex onto one whose normal is at most this far off (cosine)
+    constexpr float kMinNormalCosine = 0.5f;
+
+    // most passes before giving up on reaching the target
+    constexpr int kMaxPasses = 64;
+
+    struct Vec3 {
+        double x, y, z;
+    };
+
+    inline Vec3 Sub(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    inline Vec3 Cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    inline double Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    inline double Length(const Vec3& a) { return std::sqrt(Dot(a, a)); }
+
+    // symmetric 4x4 error quadric, stored as its upper triangle
+    struct Quadric {
+        double a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0, ad = 0, bd = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        // plane n.p + d = 0 with unit n, scaled by weight
+        static Quadric Plane(const Vec3& n, double d, double weight)
+        {
+            Quadric q;
+            q.a2 = n.x * n.x * weight; q.b2 = n.y * n.y * weight; q.c2 = n.z * n.z * weight;
+            q.ab = n.x * n.y * weight; q.ac = n.x * n.z * weight; q.bc = n.y * n.z * weight;
+            q.ad = n.x * d * weight; q.bd = n.y * d * weight; q.cd = n.z * d * weight;
+            q.d2 = d * d * weight;
+            q.weight = weight;
+            return q;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a2 += q.a2; b2 += q.b2; c2 += q.c2; ab += q.ab; ac += q.ac;
+            bc += q.bc; ad += q.ad; bd += q.bd; cd += q.cd; d2 += q.d2;
+            weight += q.weight;
+        }
+
+        // weighted mean squared distance of p to every plane summed in
+        double Error(const Vec3& p) const
+        {
+            const double rx = a2 * p.x + ab * p.y + ac * p.z + ad;
+            const double ry = ab * p.x + b2 * p.y + bc * p.z + bd;
+            const double rz = ac * p.x + bc * p.y + c2 * p.z + cd;
+            const double e = rx * p.x + ry * p.y + rz * p.z + ad * p.x + bd * p.y + cd * p.z + d2;
+            return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+        }
+    };
+
+    inline uint64_t EdgeKey(unsigned int a, unsigned int b)
+    {
+        if (a > b) std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    // vertices sharing a position get one position id
+    unsigned int BuildPositionIds(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& positionOf)
+    {
+        std::vector<unsigned int> order(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) order[v] = static_cast<unsigned int>(v);
+        auto less = [&](unsigned int a, unsigned int b) {
+            return std::memcmp(&vertices[a].position, &vertices[b].position, sizeof(glm::vec3)) < 0;
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        positionOf.assign(vertexCount, 0);
+        unsigned int count = 0;
+        for (size_t i = 0; i < vertexCount; ++i) {
+            if (i > 0 && less(order[i - 1], order[i])) ++count;
+            positionOf[order[i]] = count;
+        }
+        return vertexCount > 0 ? count + 1 : 0;
+    }
+
+    // sorted position edges of the current triangles with how many use each
+    struct EdgeCounts {
+        std::vector<uint64_t> keys;
+        std::vector<unsigned int> counts;
+
+        void Build(const std::vector<unsigned int>& triangles, const std::vector<unsigned int>& positionOf)
+        {
+            std::vector<uint64_t> all;
+            all.reserve(triangles.size());
+            for (size_t i = 0; i < triangles.size(); i += 3) {
+                for (int k = 0; k < 3; ++k) {
+                    all.push_back(EdgeKey(positionOf[triangles[i + k]], positionOf[triangles[i + (k + 1) % 3]]));
+                }
+            }
+            std::sort(all.begin(), all.end());
+            keys.clear();
+            counts.clear();
+            for (uint64_t key : all) {
+                if (!keys.empty() && keys.back() == key) {
+                    ++counts.back();
+                }
+                else {
+                    keys.push_back(key);
+                    counts.push_back(1);
+                }
+            }
+        }
+
+        unsigned int Count(unsigned int a, unsigned int b) const
+        {
+            auto it = std::lower_bound(keys.begin(), keys.end(), EdgeKey(a, b));
+            return (it != keys.end() && *it == EdgeKey(a, b)) ? counts[it - keys.begin()] : 0;
+        }
+    };
+
+    struct Candidate {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+}
+
+template <typename Index>
+size_t SimplifyMesh(Index* destination, const Index* indices, size_t indexCount,
+    const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError,
+    float* resultError)
+{
+    std::vector<unsigned int> triangles(indices, indices + indexCount / 3 * 3);
+    if (resultError) *resultError = 0.0f;
+
+    std::vector<unsigned int> positionOf;
+    const unsigned int positionCount = BuildPositionIds(vertices, vertexCount, positionOf);
+    std::vector<Vec3> position(positionCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const glm::vec3& p = vertices[v].position;
+        position[positionOf[v]] = { p.x, p.y, p.z };
+    }
+
+    // surface planes of every triangle, area weighted
+    std::vector<Quadric> quadrics(positionCount);
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        const Vec3& a = position[positionOf[triangles[i]]];
+        const Vec3 n = Cross(Sub(position[positionOf[triangles[i + 1]]], a), Sub(position[positionOf[triangles[i + 2]]], a));
+        const double area = Length(n);
+        if (area == 0.0) continue;
+        const Vec3 unit = { n.x / area, n.y / area, n.z / area };
+        const Quadric q = Quadric::Plane(unit, -Dot(unit, a), area * 0.5);
+        for (int k = 0; k < 3; ++k) quadrics[positionOf[triangles[i + k]]].Add(q);
+    }
+
+    // border edges (one triangle) and seam edges (two triangles that
+    // disagree on the vertices) get a plane through the edge, perpendicular
+    // to its face, so collapsing along them keeps their line
+    {
+        struct Corner {
+            uint64_t key;
+            uint64_t vertices;
+            unsigned int triangle;
+        };
+        std::vector<Corner> corners;
+        corners.reserve(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int a = triangles[i + k], b = triangles[i + (k + 1) % 3];
+                corners.push_back({ EdgeKey(positionOf[a], positionOf[b]), EdgeKey(a, b), static_cast<unsigned int>(i) });
+            }
+        }
+        std::sort(corners.begin(), corners.end(), [](const Corner& a, const Corner& b) { return a.key < b.key; });
+        for (size_t i = 0; i < corners.size();) {
+            size_t end = i + 1;
+            while (end < corners.size() && corners[end].key == corners[i].key) ++end;
+            const bool border = end - i == 1;
+            const bool seam = end - i == 2 && corners[i].vertices != corners[i + 1].vertices;
+            for (size_t c = i; (border || seam) && c < end; ++c) {
+                const unsigned int pa = static_cast<unsigned int>(corners[c].key >> 32);
+                const unsigned int pb = static_cast<unsigned int>(corners[c].key & 0xffffffffu);
+                const unsigned int t = corners[c].triangle;
+                const Vec3& a = position[positionOf[triangles[t]]];
+                const Vec3 faceNormal = Cross(Sub(position[positionOf[triangles[t + 1]]], a), Sub(position[positionOf[triangles[t + 2]]], a));
+                const Vec3 edge = Sub(position[pb], position[pa]);
+                Vec3 n = Cross(edge, faceNormal);
+                const double length = Length(n);
+                if (length == 0.0) continue;
+                n = { n.x / length, n.y / length, n.z / length };
+                const Quadric q = Quadric::Plane(n, -Dot(n, position[pa]), Dot(edge, edge) * kEdgeWeight);
+                quadrics[pa].Add(q);
+                quadrics[pb].Add(q);
+            }
+            i = end;
+        }
+    }
+
+    const double maxCost = static_cast<double>(targetError) * targetError;
+    double worstCost = 0.0;
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<uint8_t> locked(positionCount);
+    std::vector<uint8_t> border(positionCount);
+    std::vector<size_t> firstTriangle(positionCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<Candidate> best(positionCount);
+    EdgeCounts edges;
+
+    for (int pass = 0; pass < kMaxPasses && triangles.size() > targetIndexCount; ++pass) {
+        // triangles around each position
+        std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+        for (unsigned int v : triangles) ++firstTriangle[positionOf[v] + 1];
+        for (size_t p = 0; p < positionCount; ++p) firstTriangle[p + 1] += firstTriangle[p];
+        adjacency.resize(triangles.size());
+        {
+            std::vector<size_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+            for (size_t i = 0; i < triangles.size(); ++i) {
+                adjacency[fill[positionOf[triangles[i]]]++] = static_cast<unsigned int>(i / 3 * 3);
+            }
+        }
+
+        // open borders, and non-manifold edges which lock both ends
+        edges.Build(triangles, positionOf);
+        std::fill(locked.begin(), locked.end(), 0);
+        std::fill(border.begin(), border.end(), 0);
+        for (size_t e = 0; e < edges.keys.size(); ++e) {
+            const unsigned int a = static_cast<unsigned int>(edges.keys[e] >> 32);
+            const unsigned int b = static_cast<unsigned int>(edges.keys[e] & 0xffffffffu);
+            if (edges.counts[e] == 1) border[a] = border[b] = 1;
+            if (edges.counts[e] > 2) locked[a] = locked[b] = 1;
+        }
+
+        // cheapest legal collapse out of every position
+        for (unsigned int p = 0; p < positionCount; ++p) best[p] = { p, p, std::numeric_limits<double>::max() };
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int a = positionOf[triangles[i + k]];
+                const unsigned int b = positionOf[triangles[i + (k + 1) % 3]];
+                if (a == b) continue;
+                for (int direction = 0; direction < 2; ++direction) {
+                    const unsigned int from = direction ? b : a;
+                    const unsigned int to = direction ? a : b;
+                    if (locked[from] || (border[from] && edges.Count(from, to) != 1)) continue;
+                    Quadric q = quadrics[from];
+                    q.Add(quadrics[to]);
+                    const double cost = q.Error(position[to]);
+                    if (cost < best[from].cost) best[from] = { from, to, cost };
+                }
+            }
+        }
+
+        std::vector<Candidate> candidates;
+        for (const Candidate& candidate : best) {
+            if (candidate.from != candidate.to) candidates.push_back(candidate);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.cost < b.cost; });
+
+        for (size_t v = 0; v < vertexCount; ++v) remap[v] = static_cast<unsigned int>(v);
+        std::fill(locked.begin(), locked.end(), 0);
+
+        size_t remaining = triangles.size();
+        size_t collapses = 0;
+        std::vector<std::pair<unsigned int, unsigned int>> moves;
+        for (const Candidate& candidate : candidates) {
+            if (remaining <= targetIndexCount || candidate.cost > maxCost) break;
+            const unsigned int from = candidate.from, to = candidate.to;
+            if (locked[from] || locked[to]) continue;
+
+            // every vertex on from moves onto the vertex across the edge in the
+            // same triangle, and the faces around from must not fold or twist
+            moves.clear();
+            bool legal = true;
+            size_t removed = 0;
+            for (size_t j = firstTriangle[from]; legal && j < firstTriangle[from + 1]; ++j) {
+                const unsigned int t = adjacency[j];
+                int corner = 0, across = -1;
+                for (int k = 0; k < 3; ++k) {
+                    if (positionOf[triangles[t + k]] == from) corner = k;
+                    if (positionOf[triangles[t + k]] == to) across = k;
+                }
+                const unsigned int vertex = triangles[t + corner];
+                if (across >= 0) {
+                    moves.emplace_back(vertex, triangles[t + across]);
+                    ++removed;
+                    continue;
+                }
+
+                const Vec3& a = position[positionOf[triangles[t]]];
+                const Vec3& b = position[positionOf[triangles[t + 1]]];
+                const Vec3& c = position[positionOf[triangles[t + 2]]];
+                const Vec3 before = Cross(Sub(b, a), Sub(c, a));
+                Vec3 moved[3] = { a, b, c };
+                moved[corner] = position[to];
+                const Vec3 after = Cross(Sub(moved[1], moved[0]), Sub(moved[2], moved[0]));
+                if (Dot(before, after) <= kMinFaceCosine * Length(before) * Length(after)) legal = false;
+            }
+            if (!legal || moves.empty()) continue;
+
+            // each vertex on from needs its own target, and it has to face the same way
+            for (size_t j = firstTriangle[from]; legal && j < firstTriangle[from + 1]; ++j) {
+                const unsigned int t = adjacency[j];
+                for (int k = 0; k < 3; ++k) {
+                    const unsigned int vertex = triangles[t + k];
+                    if (positionOf[vertex] != from) continue;
+                    auto found = std::find_if(moves.begin(), moves.end(),
+                        [&](const std::pair<unsigned int, unsigned int>& move) { return move.first == vertex; });
+                    if (found == moves.end()) {
+                        legal = false;
+                    }
+                    else if (glm::dot(vertices[vertex].normal, vertices[found->second].normal) < kMinNormalCosine) {
+                        legal = false;
+                    }
+                }
+            }
+            if (!legal) continue;
+
+            for (const auto& move : moves) remap[move.first] = move.second;
+            quadrics[to].Add(quadrics[from]);
+            worstCost = std::max(worstCost, candidate.cost);
+            remaining -= removed * 3;
+            ++collapses;
+
+            // nothing else around from changes this pass
+            for (size_t j = firstTriangle[from]; j < firstTriangle[from + 1]; ++j) {
+                const unsigned int t = adjacency[j];
+                for (int k = 0; k < 3; ++k) locked[positionOf[triangles[t + k]]] = 1;
+            }
+        }
+        if (collapses == 0) break;
+
+        // apply the moves and drop triangles that lost an edge
+        size_t write = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            const unsigned int a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+            const unsigned int pa = positionOf[a], pb = positionOf[b], pc = positionOf[c];
+            if (pa == pb || pb == pc || pa == pc) continue;
+            triangles[write++] = a;
+            triangles[write++] = b;
+            triangles[write++] = c;
+        }
+        triangles.resize(write);
+    }
+
+    for (size_t i = 0; i < triangles.size(); ++i) destination[i] = static_cast<Index>(triangles[i]);
+    if (resultError) *resultError = static_cast<float>(std::sqrt(worstCost));
+    return triangles.size();
+}
+
+template size_t SimplifyMesh(unsigned short*, const unsigned short*, size_t, const Vertex*, size_t, size_t, float,
+    float*);
+template size_t SimplifyMesh(unsigned int*, const unsigned int*, size_t, const Vertex*, size_t, size_t, float,
+    float*);
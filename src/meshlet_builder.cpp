@@ -0,0 +1,220 @@
+#include "../include/meshlet_builder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    // cones wider than this (smallest dot of a triangle normal with the
+    // axis) cull too rarely to be worth testing
+    constexpr float kMinConeSpread = 0.1f;
+
+    inline glm::vec3 Position(const float* positions, size_t stride, unsigned int v)
+    {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + static_cast<size_t>(v) * stride);
+        return glm::vec3(p[0], p[1], p[2]);
+    }
+
+    // vertices sharing a position get one position id, so flat shaded faces
+    // that only share corners still count as adjacent. the simplifier sorts
+    // for the same ids, a hash on the position bits is cheaper at this size
+    size_t BuildPositionIds(const float* positions, size_t vertexCount, size_t stride, std::vector<uint32_t>& positionOf)
+    {
+        auto at = [&](size_t v) {
+            return reinterpret_cast<const char*>(positions) + v * stride;
+        };
+        size_t tableSize = 1;
+        while (tableSize < vertexCount * 2) tableSize <<= 1;
+        constexpr uint32_t kEmpty = UINT32_MAX;
+        std::vector<uint32_t> table(tableSize, kEmpty);   // first vertex at each position
+
+        positionOf.assign(vertexCount, 0);
+        uint32_t count = 0;
+        for (size_t v = 0; v < vertexCount; ++v) {
+            uint32_t bits[3];
+            std::memcpy(bits, at(v), sizeof(bits));
+            uint64_t h = (bits[0] * 0x9E3779B1ull) ^ (bits[1] * 0x85EBCA77ull) ^ (bits[2] * 0xC2B2AE3Dull);
+            h ^= h >> 29;
+            size_t slot = static_cast<size_t>(h) & (tableSize - 1);
+            while (table[slot] != kEmpty && std::memcmp(at(table[slot]), bits, sizeof(bits)) != 0) {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            if (table[slot] == kEmpty) {
+                table[slot] = static_cast<uint32_t>(v);
+                positionOf[v] = count++;
+            }
+            else {
+                positionOf[v] = positionOf[table[slot]];
+            }
+        }
+        return count;
+    }
+}
+
+template <typename Index>
+void ComputeMeshletBounds(Meshlet& meshlet, const Index* indices, const float* positions, size_t stride)
+{
+    const Index* first = indices + meshlet.indexOffset;
+    const size_t indexCount = static_cast<size_t>(meshlet.triangleCount) * 3;
+    if (indexCount == 0) return;
+
+    // sphere around the box centre, tight enough for clusters this small
+    glm::vec3 low = Position(positions, stride, first[0]), high = low;
+    for (size_t i = 1; i < indexCount; ++i) {
+        const glm::vec3 p = Position(positions, stride, first[i]);
+        low = glm::min(low, p);
+        high = glm::max(high, p);
+    }
+    meshlet.center = (low + high) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (size_t i = 0; i < indexCount; ++i) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(Position(positions, stride, first[i]) - meshlet.center));
+    }
+
+    // axis is the average face normal, cutoff the sine of the widest angle
+    // between it and a face normal
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangleCount);
+    glm::vec3 axis(0.0f);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const glm::vec3 a = Position(positions, stride, first[i]);
+        const glm::vec3 n = glm::cross(Position(positions, stride, first[i + 1]) - a, Position(positions, stride, first[i + 2]) - a);
+        const float area = glm::length(n);
+        if (area == 0.0f) continue;
+        normals.push_back(n / area);
+        axis += normals.back();
+    }
+    meshlet.coneApex = meshlet.center;
+    meshlet.coneAxis = glm::vec3(0.0f);
+    meshlet.coneCutoff = 2.0f;
+    const float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength == 0.0f) return;
+    axis = axis / axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals) minDot = std::min(minDot, glm::dot(n, axis));
+    meshlet.coneAxis = axis;
+    if (minDot <= kMinConeSpread) return;
+
+    // move the apex back along the axis until it is behind every triangle
+    // plane, so the test holds for any point of the meshlet
+    float back = 0.0f;
+    size_t normal = 0;
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const glm::vec3 a = Position(positions, stride, first[i]);
+        const glm::vec3 n = glm::cross(Position(positions, stride, first[i + 1]) - a, Position(positions, stride, first[i + 2]) - a);
+        if (glm::length(n) == 0.0f) continue;
+        const glm::vec3& unit = normals[normal++];
+        back = std::max(back, glm::dot(meshlet.center - a, unit) / glm::dot(axis, unit));
+    }
+    meshlet.coneApex = meshlet.center - axis * back;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+template <typename Index>
+std::vector<Meshlet> BuildMeshlets(Index* destination, const Index* indices, size_t indexCount,
+    const float* positions, size_t vertexCount, size_t stride, size_t maxVertices, size_t maxTriangles)
+{
+    const size_t triangleCount = indexCount / 3;
+    std::vector<Meshlet> meshlets;
+    if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0) return meshlets;
+
+    // triangles around each position, and how many of them are still unplaced
+    std::vector<uint32_t> positionOf;
+    const size_t positionCount = BuildPositionIds(positions, vertexCount, stride, positionOf);
+    std::vector<uint32_t> firstTriangle(positionCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) ++firstTriangle[positionOf[indices[i]] + 1];
+    for (size_t p = 0; p < positionCount; ++p) firstTriangle[p + 1] += firstTriangle[p];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> liveTriangles(positionCount);
+    {
+        std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            const uint32_t p = positionOf[indices[i]];
+            adjacency[fill[p]++] = static_cast<uint32_t>(i / 3);
+            ++liveTriangles[p];
+        }
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    std::vector<uint8_t> placed(triangleCount, 0);
+    // meshlet number + 1 of the meshlet a vertex was last added to
+    std::vector<uint32_t> inMeshlet(vertexCount, 0);
+    std::vector<unsigned int> meshletVertices;
+    meshletVertices.reserve(maxVertices);
+    // the same for positions, several vertices of a meshlet may share one
+    std::vector<uint32_t> positionInMeshlet(positionCount, 0);
+    std::vector<uint32_t> meshletPositions;
+    meshletPositions.reserve(maxVertices);
+
+    size_t seed = 0;
+    size_t placedCount = 0;
+    while (placedCount < triangleCount) {
+        while (placed[seed]) ++seed;
+
+        Meshlet meshlet;
+        meshlet.indexOffset = static_cast<uint32_t>(output.size());
+        const uint32_t stamp = static_cast<uint32_t>(meshlets.size() + 1);
+        meshletVertices.clear();
+        meshletPositions.clear();
+
+        size_t next = seed;
+        while (true) {
+            // place the chosen triangle
+            placed[next] = 1;
+            ++placedCount;
+            ++meshlet.triangleCount;
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int v = indices[next * 3 + k];
+                const uint32_t p = positionOf[v];
+                output.push_back(v);
+                --liveTriangles[p];
+                if (inMeshlet[v] != stamp) {
+                    inMeshlet[v] = stamp;
+                    meshletVertices.push_back(v);
+                }
+                if (positionInMeshlet[p] != stamp) {
+                    positionInMeshlet[p] = stamp;
+                    meshletPositions.push_back(p);
+                }
+            }
+            if (meshlet.triangleCount >= maxTriangles) break;
+
+            // the unplaced neighbour that adds the fewest vertices, first found on ties
+            size_t best = triangleCount;
+            size_t bestNew = 3;
+            for (size_t i = 0; i < meshletPositions.size() && bestNew > 0; ++i) {
+                const uint32_t p = meshletPositions[i];
+                if (liveTriangles[p] == 0) continue;
+                for (uint32_t j = firstTriangle[p]; j < firstTriangle[p + 1]; ++j) {
+                    const uint32_t t = adjacency[j];
+                    if (placed[t]) continue;
+                    size_t added = 0;
+                    for (int k = 0; k < 3; ++k) added += inMeshlet[indices[t * 3 + k]] != stamp;
+                    if (added < bestNew || (added == bestNew && best == triangleCount)) {
+                        best = t;
+                        bestNew = added;
+                        if (added == 0) break;
+                    }
+                }
+            }
+            if (best == triangleCount || meshletVertices.size() + bestNew > maxVertices) break;
+            next = best;
+        }
+
+        meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+        meshlets.push_back(meshlet);
+    }
+
+    for (size_t i = 0; i < output.size(); ++i) destination[i] = static_cast<Index>(output[i]);
+    for (Meshlet& meshlet : meshlets) ComputeMeshletBounds(meshlet, destination, positions, stride);
+    return meshlets;
+}
+
+template std::vector<Meshlet> BuildMeshlets(unsigned short*, const unsigned short*, size_t, const float*, size_t, size_t,
+    size_t, size_t);
+template std::vector<Meshlet> BuildMeshlets(unsigned int*, const unsigned int*, size_t, const float*, size_t, size_t,
+    size_t, size_t);
+template void ComputeMeshletBounds(Meshlet&, const unsigned short*, const float*, size_t);
+template void ComputeMeshletBounds(Meshlet&, const unsigned int*, const float*, size_t);
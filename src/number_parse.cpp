@@ -0,0 +1,164 @@
+#include "../include/number_parse.h"
+#include <charconv>
+#include <cfloat>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    // every power of ten up to 1e22 is exact in a double
+    const double kPow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+        1e21, 1e22
+    };
+
+    inline bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // fallback for inputs the fast path can't round correctly
+    NumberResult SlowFloat(const char* first, const char* digits, const char* last, bool negative, int exponent, float& value)
+    {
+        float parsed = 0.0f;
+        auto result = std::from_chars(digits, last, parsed);
+        if (result.ec == std::errc::result_out_of_range) {
+            // underflow flushes to zero, only overflow is an error
+            if (exponent >= 0) return { first, NumberError::OutOfRange };
+            value = negative ? -0.0f : 0.0f;
+            return { result.ptr, NumberError::None };
+        }
+        if (result.ec != std::errc()) return { first, NumberError::Invalid };
+        value = negative ? -parsed : parsed;
+        return { result.ptr, NumberError::None };
+    }
+}
+
+NumberResult ParseFloat(const char* first, const char* last, float& value)
+{
+    const char* p = first;
+    bool negative = false;
+    if (p < last && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    const char* digits = p;
+
+    // accumulate up to 19 significant digits, remembering the decimal exponent
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int significant = 0;
+    bool truncated = false;
+    bool anyDigits = false;
+
+    for (; p < last && IsDigit(*p); ++p) {
+        anyDigits = true;
+        if (significant < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            if (mantissa != 0) ++significant;
+        }
+        else {
+            ++exponent;
+            if (*p != '0') truncated = true;
+        }
+    }
+
+    if (p < last && *p == '.') {
+        ++p;
+        for (; p < last && IsDigit(*p); ++p) {
+            anyDigits = true;
+            if (significant < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                if (mantissa != 0) ++significant;
+                --exponent;
+            }
+            else if (*p != '0') {
+                truncated = true;
+            }
+        }
+    }
+
+    if (!anyDigits) return { first, NumberError::Invalid };
+
+    // exponent part only counts when digits follow the marker
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool expNegative = false;
+        if (e < last && (*e == '+' || *e == '-')) {
+            expNegative = (*e == '-');
+            ++e;
+        }
+        if (e < last && IsDigit(*e)) {
+            int expValue = 0;
+            for (; e < last && IsDigit(*e); ++e) {
+                if (expValue < 100000) expValue = expValue * 10 + (*e - '0');
+            }
+            exponent += expNegative ? -expValue : expValue;
+            p = e;
+        }
+    }
+
+    if (mantissa == 0 && !truncated) {
+        value = negative ? -0.0f : 0.0f;
+        return { p, NumberError::None };
+    }
+
+    // clinger fast path: mantissa and power of ten are both exact doubles,
+    // so one multiply or divide gives the correctly rounded double
+    if (truncated || mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22) {
+        return SlowFloat(first, digits, last, negative, exponent, value);
+    }
+
+    double d = static_cast<double>(mantissa);
+    d = (exponent < 0) ? d / kPow10[-exponent] : d * kPow10[exponent];
+
+    // narrowing to float is only a second correct rounding when the double
+    // is not sitting exactly halfway between two floats, and both are normal
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    if (d < FLT_MIN || d > FLT_MAX || (bits & 0x1FFFFFFFull) == 0x10000000ull) {
+        return SlowFloat(first, digits, last, negative, exponent, value);
+    }
+
+    float f = static_cast<float>(d);
+    value = negative ? -f : f;
+    return { p, NumberError::None };
+}
+
+NumberResult ParseInt(const char* first, const char* last, int& value)
+{
+    const char* p = first;
+    bool negative = false;
+    if (p < last && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    if (p == last || !IsDigit(*p)) return { first, NumberError::Invalid };
+
+    // accumulate as a positive magnitude, int min is one larger than int max
+    const int64_t limit = negative ? -static_cast<int64_t>(INT_MIN) : INT_MAX;
+    int64_t magnitude = 0;
+    bool overflow = false;
+    for (; p < last && IsDigit(*p); ++p) {
+        if (!overflow) {
+            magnitude = magnitude * 10 + (*p - '0');
+            if (magnitude > limit) overflow = true;
+        }
+    }
+
+    if (overflow) return { first, NumberError::OutOfRange };
+    value = static_cast<int>(negative ? -magnitude : magnitude);
+    return { p, NumberError::None };
+}
+
+const char* NumberErrorString(NumberError error)
+{
+    switch (error) {
+    case NumberError::None: return "ok";
+    case NumberError::Invalid: return "invalid number";
+    case NumberError::OutOfRange: return "number out of range";
+    }
+    return "unknown error";
+}
@@ -0,0 +1,115 @@
+#include "../include/polygon_triangulator.h"
+
+namespace {
+    using Point = PolygonScratch::Point;
+
+    inline double Cross(const Point& a, const Point& b, const Point& c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    inline bool Same(const Point& a, const Point& b)
+    {
+        return a.x == b.x && a.y == b.y;
+    }
+
+    // p strictly inside the counter-clockwise triangle abc, points on an edge
+    // do not count so collinear corners never block an ear
+    inline bool Inside(const Point& p, const Point& a, const Point& b, const Point& c)
+    {
+        return Cross(a, b, p) > 0.0 && Cross(b, c, p) > 0.0 && Cross(c, a, p) > 0.0;
+    }
+
+    // corner ring[at] is convex and no other remaining corner lies in its triangle
+    bool IsEar(const Point* points, const uint32_t* ring, size_t remaining, size_t at)
+    {
+        const uint32_t prev = ring[(at + remaining - 1) % remaining];
+        const uint32_t cur = ring[at];
+        const uint32_t next = ring[(at + 1) % remaining];
+        const Point& a = points[prev];
+        const Point& b = points[cur];
+        const Point& c = points[next];
+        if (Cross(a, b, c) < 0.0) return false;
+
+        for (size_t i = 0; i < remaining; ++i) {
+            const uint32_t corner = ring[i];
+            if (corner == prev || corner == cur || corner == next) continue;
+            const Point& p = points[corner];
+            // a corner repeated on top of the ear's own corners can't be inside it
+            if (Same(p, a) || Same(p, b) || Same(p, c)) continue;
+            if (Inside(p, a, b, c)) return false;
+        }
+        return true;
+    }
+}
+
+size_t TriangulatePolygon(const glm::vec3* corners, size_t count, uint32_t* triangles, PolygonScratch& scratch)
+{
+    if (count < 3) return 0;
+    if (count == 3) {
+        triangles[0] = 0;
+        triangles[1] = 1;
+        triangles[2] = 2;
+        return 1;
+    }
+
+    // newell normal, robust for non-planar and partly collinear polygons
+    double normal[3] = { 0.0, 0.0, 0.0 };
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3& a = corners[i];
+        const glm::vec3& b = corners[(i + 1) % count];
+        normal[0] += (static_cast<double>(a.y) - b.y) * (static_cast<double>(a.z) + b.z);
+        normal[1] += (static_cast<double>(a.z) - b.z) * (static_cast<double>(a.x) + b.x);
+        normal[2] += (static_cast<double>(a.x) - b.x) * (static_cast<double>(a.y) + b.y);
+    }
+
+    // drop the dominant axis, mirroring the projection where needed so the
+    // polygon winds counter-clockwise in 2d
+    const double nx = normal[0] < 0.0 ? -normal[0] : normal[0];
+    const double ny = normal[1] < 0.0 ? -normal[1] : normal[1];
+    const double nz = normal[2] < 0.0 ? -normal[2] : normal[2];
+    const int axis = (nx > ny && nx > nz) ? 0 : (ny > nz ? 1 : 2);
+    const int u = (axis + 1) % 3;
+    const int v = (axis + 2) % 3;
+    const double flip = normal[axis] < 0.0 ? -1.0 : 1.0;
+
+    Point fixedPoints[kFixedPolygonCorners];
+    uint32_t fixedRing[kFixedPolygonCorners];
+    Point* points = fixedPoints;
+    uint32_t* ring = fixedRing;
+    if (count > kFixedPolygonCorners) {
+        scratch.points.resize(count);
+        scratch.ring.resize(count);
+        points = scratch.points.data();
+        ring = scratch.ring.data();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const double p[3] = { corners[i].x, corners[i].y, corners[i].z };
+        points[i] = Point{ p[u] * flip, p[v] };
+        ring[i] = static_cast<uint32_t>(i);
+    }
+
+    size_t written = 0;
+    size_t remaining = count;
+    size_t at = 1;
+    size_t misses = 0;
+    while (remaining > 3) {
+        if (misses < remaining && !IsEar(points, ring, remaining, at)) {
+            at = (at + 1) % remaining;
+            ++misses;
+            continue;
+        }
+
+        triangles[written++] = ring[(at + remaining - 1) % remaining];
+        triangles[written++] = ring[at];
+        triangles[written++] = ring[(at + 1) % remaining];
+        for (size_t i = at; i + 1 < remaining; ++i) ring[i] = ring[i + 1];
+        --remaining;
+        if (at == remaining) at = 0;
+        misses = 0;
+    }
+    triangles[written++] = ring[0];
+    triangles[written++] = ring[1];
+    triangles[written++] = ring[2];
+    return written / 3;
+}
@@ -0,0 +1,274 @@
+#include "../include/profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> Profiler::recording{ false };
+
+namespace {
+    struct ZoneRecord {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // the zones from first on, up to the next batch, came from one thread
+    // and show in the trace under its id and name
+    struct ZoneBatch {
+        uint64_t first;
+        uint32_t id;
+        std::string name;
+    };
+
+    // written only by the thread that owns it. written counts every zone
+    // ever recorded, the ring holds the last kZonesPerThread of them
+    struct ThreadBuffer {
+        std::vector<ZoneBatch> batches; // guarded by the registry mutex, the owner's is last
+        uint64_t cleared = 0;           // zones before this were dropped by Clear
+        bool retired = false;           // the owning thread exited
+        std::unique_ptr<ZoneRecord[]> zones;
+        std::atomic<uint64_t> written{ 0 };
+    };
+
+    // buffers outlive their threads so a trace still shows the workers of a
+    // finished load. a new thread takes over a retired buffer before a new
+    // one is made, which keeps memory bounded by the peak thread count. it
+    // starts a batch there, the zones still held from the old owner keep
+    // that thread's id and name
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        uint32_t threadCount = 0;
+
+        // clock reading at the first Start, to convert ticks to time
+        bool calibrated = false;
+        uint64_t startTicks = 0;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    struct ThreadSlot {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadSlot()
+        {
+            if (!buffer) return;
+            std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+            buffer->retired = true;
+        }
+    };
+
+    thread_local ThreadSlot slot;
+    thread_local const char* threadName = nullptr;
+
+    // first zone a buffer still holds, older ones were overwritten or cleared
+    uint64_t FirstHeld(const ThreadBuffer& buffer, uint64_t written)
+    {
+        return std::max(buffer.cleared, written > Profiler::kZonesPerThread ? written - Profiler::kZonesPerThread : 0);
+    }
+
+    // the calling thread's buffer, made on its first zone
+    ThreadBuffer& LocalBuffer()
+    {
+        if (slot.buffer) return *slot.buffer;
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        const uint32_t id = ++registry.threadCount;
+        const char* name = threadName ? threadName : "";
+        for (auto& buffer : registry.buffers) {
+            if (buffer->retired) {
+                buffer->retired = false;
+                const uint64_t written = buffer->written.load(std::memory_order_relaxed);
+
+                // keep the batches that still have zones held
+                const uint64_t from = FirstHeld(*buffer, written);
+                std::vector<ZoneBatch> batches;
+                for (size_t b = 0; b < buffer->batches.size(); ++b) {
+                    const uint64_t end = b + 1 < buffer->batches.size() ? buffer->batches[b + 1].first : written;
+                    if (end > from) batches.push_back(std::move(buffer->batches[b]));
+                }
+                batches.push_back({ written, id, name });
+                buffer->batches.swap(batches);
+                slot.buffer = buffer;
+                return *buffer;
+            }
+        }
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->batches.push_back({ 0, id, name });
+        buffer->zones.reset(new ZoneRecord[Profiler::kZonesPerThread]);
+        registry.buffers.push_back(buffer);
+        slot.buffer = buffer;
+        return *buffer;
+    }
+
+    // ticks per microsecond, measured against steady_clock since the first Start
+    double TicksPerMicrosecond(Registry& registry)
+    {
+#if PROFILER_TSC
+        using namespace std::chrono;
+        if (!registry.calibrated) return 1.0;
+        // a short baseline makes a poor estimate, wait until it is 10ms long
+        std::this_thread::sleep_until(registry.startTime + milliseconds(10));
+        const uint64_t ticks = Profiler::Now() - registry.startTicks;
+        const double us = duration<double, std::micro>(steady_clock::now() - registry.startTime).count();
+        return static_cast<double>(ticks) / us;
+#else
+        (void)registry;
+        return 1000.0;
+#endif
+    }
+
+    void WriteString(std::string& out, const char* text)
+    {
+        out += '"';
+        for (const char* c = text; *c; ++c) {
+            if (*c == '"' || *c == '\\') out += '\\';
+            if (static_cast<unsigned char>(*c) >= 0x20) out += *c;
+        }
+        out += '"';
+    }
+}
+
+void Profiler::Start()
+{
+    Registry& registry = GetRegistry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!registry.calibrated) {
+            registry.startTicks = Now();
+            registry.startTime = std::chrono::steady_clock::now();
+            registry.calibrated = true;
+        }
+    }
+    recording.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::Stop()
+{
+    recording.store(false, std::memory_order_relaxed);
+}
+
+void Profiler::Record(const char* name, uint64_t begin, uint64_t end)
+{
+    ThreadBuffer& buffer = LocalBuffer();
+    const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.zones[index % kZonesPerThread] = ZoneRecord{ name, begin, end };
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::NameThread(const char* name)
+{
+    threadName = name;
+    if (!slot.buffer) return;
+    std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+    slot.buffer->batches.back().name = name;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const double ticksPerUs = TicksPerMicrosecond(registry);
+
+    // copy out what each ring holds. a thread still recording may overwrite
+    // the oldest zones meanwhile, those are dropped after the copy
+    struct ThreadZones {
+        uint32_t id;
+        std::string name;
+        std::vector<ZoneRecord> zones;
+    };
+    std::vector<ThreadZones> threads;
+    uint64_t origin = UINT64_MAX;
+    std::vector<ZoneRecord> zones;
+    for (const auto& buffer : registry.buffers) {
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = FirstHeld(*buffer, written);
+
+        zones.clear();
+        zones.reserve(static_cast<size_t>(written - first));
+        for (uint64_t i = first; i < written; ++i) zones.push_back(buffer->zones[i % kZonesPerThread]);
+
+        const uint64_t after = buffer->written.load(std::memory_order_acquire);
+        if (after > kZonesPerThread && after - kZonesPerThread > first) {
+            const size_t overwritten = static_cast<size_t>(std::min(after - kZonesPerThread - first, written - first));
+            zones.erase(zones.begin(), zones.begin() + overwritten);
+            first += overwritten;
+        }
+        for (const ZoneRecord& zone : zones) origin = std::min(origin, zone.begin);
+
+        // one trace thread per batch, the owner's is kept even while empty
+        const std::vector<ZoneBatch>& batches = buffer->batches;
+        for (size_t b = 0; b < batches.size(); ++b) {
+            const uint64_t low = std::max(batches[b].first, first);
+            const uint64_t high = b + 1 < batches.size() ? std::min(batches[b + 1].first, written) : written;
+            if (low >= high && b + 1 < batches.size()) continue;
+
+            ThreadZones thread{ batches[b].id, batches[b].name, {} };
+            if (low < high) thread.zones.assign(zones.begin() + (low - first), zones.begin() + (high - first));
+            threads.push_back(std::move(thread));
+        }
+    }
+
+    std::string out = "{\"traceEvents\":[\n";
+    bool firstEvent = true;
+    char number[96];
+    auto beginEvent = [&]() {
+        if (!firstEvent) out += ",\n";
+        firstEvent = false;
+    };
+    for (const ThreadZones& thread : threads) {
+        if (!thread.name.empty()) {
+            beginEvent();
+            std::snprintf(number, sizeof(number), "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", thread.id);
+            out += number;
+            WriteString(out, thread.name.c_str());
+            out += "}}";
+        }
+        for (const ZoneRecord& zone : thread.zones) {
+            beginEvent();
+            out += "{\"ph\":\"X\",\"pid\":1,\"name\":";
+            WriteString(out, zone.name);
+            std::snprintf(number, sizeof(number), ",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread.id,
+                static_cast<double>(zone.begin - origin) / ticksPerUs,
+                static_cast<double>(zone.end - zone.begin) / ticksPerUs);
+            out += number;
+        }
+    }
+    out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return file.good();
+}
+
+void Profiler::Clear()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto& buffer : registry.buffers) buffer->cleared = buffer->written.load(std::memory_order_acquire);
+}
+
+#else
+
+void Profiler::Start() {}
+void Profiler::Stop() {}
+void Profiler::Record(const char*, uint64_t, uint64_t) {}
+void Profiler::NameThread(const char*) {}
+bool Profiler::WriteChromeTrace(const std::string&) { return false; }
+void Profiler::Clear() {}
+
+#endif
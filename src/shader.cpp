@@ -1,8 +1,8 @@
 #include "../include/shader.h"
+#include "../include/log.h"
 #include <fstream>
 #include <sstream>
 #include <glad/glad.h>
-#include <iostream>
 
 // compile shader helper: compile and return shader id or 0 on failure
 static unsigned int CompileShader(unsigned int type, const char* source)
@@ -16,7 +16,7 @@ static unsigned int CompileShader(unsigned int type, const char* source)
     if (!success) {
         char infoLog[1024];
         glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
-        std::cerr << "shader compile error: " << infoLog << "\n";
+        LOG_ERROR("shader", "Compile failed: " << infoLog);
         glDeleteShader(shader);
         return 0;
     }
@@ -59,7 +59,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
         // compilation failed, ensure cleanup and keep ID == 0
         if (vert) glDeleteShader(vert);
         if (frag) glDeleteShader(frag);
-        std::cerr << "error: shader compilation failed\n";
+        LOG_ERROR("shader", "Could not build program from " << vertexPath << " and " << fragmentPath);
         return;
     }
 
@@ -74,7 +74,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     if (!success) {
         char infoLog[1024];
         glGetProgramInfoLog(ID, sizeof(infoLog), nullptr, infoLog);
-        std::cerr << "error: shader link failed: " << infoLog << "\n";
+        LOG_ERROR("shader", "Link failed: " << infoLog);
         glDeleteProgram(ID);
         ID = 0;
     }
@@ -110,3 +110,17 @@ void Shader::setVec3(const std::string& name, const glm::vec3& value) const
     if (loc >= 0) glUniform3fv(loc, 1, glm::value_ptr(value));
 }
 
+// set vec2 uniform
+void Shader::setVec2(const std::string& name, const glm::vec2& value) const
+{
+    int loc = getUniformLocation(name);
+    if (loc >= 0) glUniform2fv(loc, 1, glm::value_ptr(value));
+}
+
+// set bool uniform
+void Shader::setBool(const std::string& name, bool value) const
+{
+    int loc = getUniformLocation(name);
+    if (loc >= 0) glUniform1i(loc, value ? 1 : 0);
+}
+
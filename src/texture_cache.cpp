@@ -0,0 +1,167 @@
+#include "../include/texture_cache.h"
+#include "../include/hash.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    const char kMagic[8] = { 'O', 'B', 'J', 'T', 'E', 'X', 'C', 0x1A };
+
+    constexpr uint64_t kLevelAlignment = 16;
+
+    uint64_t AlignUp(uint64_t value)
+    {
+        return (value + kLevelAlignment - 1) & ~(kLevelAlignment - 1);
+    }
+
+    void HashHeader(Hash64& hash, TextureCacheHeader header)
+    {
+        header.checksum = 0;
+        hash.Update(&header, sizeof(header));
+    }
+
+    bool KnownFormat(TextureFormat format)
+    {
+        return format == TextureFormat::RGBA8 || format == TextureFormat::BC1
+            || format == TextureFormat::BC3 || format == TextureFormat::BC7;
+    }
+}
+
+CacheStatus TextureCache::Reject(const std::string& reason)
+{
+    error = reason;
+    file.Close();
+    levels.clear();
+    return CacheStatus::Invalid;
+}
+
+CacheStatus TextureCache::Open(const std::string& path)
+{
+    error.clear();
+    levels.clear();
+    if (!file.Open(path)) return CacheStatus::Missing;
+
+    const char* data = file.Data();
+    const uint64_t size = file.Size();
+    if (size < sizeof(TextureCacheHeader)) {
+        return Reject("truncated header (" + std::to_string(size) + " bytes)");
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) return Reject("not a texture cache file");
+    if (header.endianTag != kMeshCacheEndianTag) return Reject("written with a different byte order");
+    if (header.version != kTextureCacheVersion) {
+        return Reject("version " + std::to_string(header.version) + ", expected " + std::to_string(kTextureCacheVersion));
+    }
+    if (header.headerSize != sizeof(TextureCacheHeader)) return Reject("unexpected header size");
+    if (header.fileSize != size) {
+        return Reject("size mismatch (" + std::to_string(size) + " bytes, header says " + std::to_string(header.fileSize) + ")");
+    }
+    if (!KnownFormat(header.format)) return Reject("unknown texture format");
+
+    const uint64_t tableEnd = sizeof(TextureCacheHeader) + static_cast<uint64_t>(header.levelCount) * sizeof(TextureCacheLevel);
+    if (header.levelCount == 0 || tableEnd > size) return Reject("truncated level table");
+    levels.resize(header.levelCount);
+    std::memcpy(levels.data(), data + sizeof(TextureCacheHeader), levels.size() * sizeof(TextureCacheLevel));
+
+    // each level must sit inside the file and hold exactly its blocks, and
+    // halve the one before it like a mip chain, uploads rely on both
+    if (header.levelCount > 32) return Reject("too many levels");
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        const TextureCacheLevel& level = levels[i];
+        if (level.offset < tableEnd || level.offset > size || level.size > size - level.offset) {
+            return Reject("level out of bounds");
+        }
+        if (level.width != std::max(1u, header.width >> i) || level.height != std::max(1u, header.height >> i)) {
+            return Reject("level " + std::to_string(i) + " is not a mip of the level above");
+        }
+        if (level.width == 0 || level.height == 0 ||
+            level.size != LevelSize(header.format, static_cast<int>(level.width), static_cast<int>(level.height))) {
+            return Reject("level size disagrees with its dimensions");
+        }
+    }
+
+    Hash64 hash;
+    HashHeader(hash, header);
+    hash.Update(data + sizeof(TextureCacheHeader), static_cast<size_t>(size - sizeof(TextureCacheHeader)));
+    if (hash.Digest() != header.checksum) return Reject("checksum mismatch");
+
+    return CacheStatus::Ok;
+}
+
+const unsigned char* TextureCache::LevelData(size_t index) const
+{
+    return reinterpret_cast<const unsigned char*>(file.Data() + levels[index].offset);
+}
+
+bool TextureCache::Read(TextureImage& image) const
+{
+    if (!file.IsOpen()) return false;
+    image.format = header.format;
+    image.levels.resize(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        MipLevel& level = image.levels[i];
+        level.width = static_cast<int>(levels[i].width);
+        level.height = static_cast<int>(levels[i].height);
+        const unsigned char* payload = LevelData(i);
+        level.pixels.assign(payload, payload + levels[i].size);
+    }
+    return true;
+}
+
+bool TextureCache::Write(const std::string& path, const MeshCacheSource& source, const TextureImage& image)
+{
+    if (image.levels.empty()) return false;
+
+    TextureCacheHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kTextureCacheVersion;
+    header.endianTag = kMeshCacheEndianTag;
+    header.headerSize = sizeof(TextureCacheHeader);
+    header.levelCount = static_cast<uint32_t>(image.levels.size());
+    header.format = image.format;
+    header.width = static_cast<uint32_t>(image.levels[0].width);
+    header.height = static_cast<uint32_t>(image.levels[0].height);
+    header.source = source;
+
+    std::vector<TextureCacheLevel> table(image.levels.size());
+    uint64_t offset = AlignUp(sizeof(TextureCacheHeader) + table.size() * sizeof(TextureCacheLevel));
+    for (size_t i = 0; i < table.size(); ++i) {
+        const MipLevel& level = image.levels[i];
+        table[i] = { static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height), offset, level.pixels.size() };
+        offset = AlignUp(offset + level.pixels.size());
+    }
+    header.fileSize = offset;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.good()) return false;
+
+    Hash64 hash;
+    HashHeader(hash, header);
+    uint64_t written = sizeof(TextureCacheHeader);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    auto emit = [&](const void* bytes, uint64_t size) {
+        if (size == 0) return;
+        hash.Update(bytes, static_cast<size_t>(size));
+        out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+        written += size;
+    };
+    auto pad = [&]() {
+        static const char zeros[kLevelAlignment] = {};
+        emit(zeros, AlignUp(written) - written);
+    };
+
+    emit(table.data(), table.size() * sizeof(TextureCacheLevel));
+    for (const MipLevel& level : image.levels) {
+        pad();
+        emit(level.pixels.data(), level.pixels.size());
+    }
+    pad();
+
+    header.checksum = hash.Digest();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    return !out.fail();
+}
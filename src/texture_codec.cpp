@@ -0,0 +1,520 @@
+#include "../include/texture_codec.h"
+#include "../include/thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_CODEC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // linear values are quantised to this many steps on the way back to srgb
+    constexpr int kLinearSteps = 4096;
+
+    // block rows per task when encoding on a pool
+    constexpr int kRowsPerTask = 16;
+
+    struct SrgbTables {
+        float toLinear[256];
+        unsigned char toSrgb[kLinearSteps];
+
+        SrgbTables()
+        {
+            for (int i = 0; i < 256; ++i) {
+                const float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < kLinearSteps; ++i) {
+                const float l = static_cast<float>(i) / (kLinearSteps - 1);
+                const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                toSrgb[i] = static_cast<unsigned char>(std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f));
+            }
+        }
+    };
+
+    const SrgbTables& Tables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    // a level in linear light, four floats per texel
+    struct LinearLevel {
+        int width = 0;
+        int height = 0;
+        std::vector<float> texels;
+    };
+
+    inline void Expand(const unsigned char* texel, float* out)
+    {
+        const SrgbTables& tables = Tables();
+        out[0] = tables.toLinear[texel[0]];
+        out[1] = tables.toLinear[texel[1]];
+        out[2] = tables.toLinear[texel[2]];
+        out[3] = texel[3] / 255.0f;
+    }
+
+    inline void Average4(const float* a, const float* b, const float* c, const float* d, float* out)
+    {
+#ifdef TEXTURE_CODEC_SSE2
+        const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)),
+            _mm_add_ps(_mm_loadu_ps(c), _mm_loadu_ps(d)));
+        _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+        for (int k = 0; k < 4; ++k) out[k] = (a[k] + b[k] + c[k] + d[k]) * 0.25f;
+#endif
+    }
+
+    // 2x2 box filter of a level whose texels fetch(x, y, float[4]) provides,
+    // edges clamp on odd sizes
+    template <typename Fetch>
+    LinearLevel Downsample(int width, int height, Fetch fetch)
+    {
+        LinearLevel level;
+        level.width = std::max(1, width / 2);
+        level.height = std::max(1, height / 2);
+        level.texels.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+        float a[4], b[4], c[4], d[4];
+        for (int y = 0; y < level.height; ++y) {
+            const int y0 = std::min(y * 2, height - 1);
+            const int y1 = std::min(y * 2 + 1, height - 1);
+            for (int x = 0; x < level.width; ++x) {
+                const int x0 = std::min(x * 2, width - 1);
+                const int x1 = std::min(x * 2 + 1, width - 1);
+                fetch(x0, y0, a);
+                fetch(x1, y0, b);
+                fetch(x0, y1, c);
+                fetch(x1, y1, d);
+                Average4(a, b, c, d, &level.texels[(static_cast<size_t>(y) * level.width + x) * 4]);
+            }
+        }
+        return level;
+    }
+
+    MipLevel ToSrgb8(const LinearLevel& linear)
+    {
+        const SrgbTables& tables = Tables();
+        MipLevel level;
+        level.width = linear.width;
+        level.height = linear.height;
+        const size_t count = static_cast<size_t>(linear.width) * linear.height;
+        level.pixels.resize(count * 4);
+
+        const float* in = linear.texels.data();
+        unsigned char* out = level.pixels.data();
+#ifdef TEXTURE_CODEC_SSE2
+        // colour goes through the table, alpha straight to 8 bits
+        const __m128 scale = _mm_setr_ps(kLinearSteps - 1.0f, kLinearSteps - 1.0f, kLinearSteps - 1.0f, 255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        alignas(16) int steps[4];
+        for (size_t i = 0; i < count; ++i, in += 4, out += 4) {
+            const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), zero), one);
+            _mm_store_si128(reinterpret_cast<__m128i*>(steps), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, scale), half)));
+            out[0] = tables.toSrgb[steps[0]];
+            out[1] = tables.toSrgb[steps[1]];
+            out[2] = tables.toSrgb[steps[2]];
+            out[3] = static_cast<unsigned char>(steps[3]);
+        }
+#else
+        for (size_t i = 0; i < count; ++i, in += 4, out += 4) {
+            for (int k = 0; k < 3; ++k) {
+                const float l = std::min(std::max(in[k], 0.0f), 1.0f);
+                out[k] = tables.toSrgb[static_cast<int>(l * (kLinearSteps - 1) + 0.5f)];
+            }
+            out[3] = static_cast<unsigned char>(std::min(std::max(in[3], 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+#endif
+        return level;
+    }
+
+    // 4x4 texels of level starting at block (bx, by), edges clamp
+    void FetchBlock(const MipLevel& level, int bx, int by, unsigned char block[64])
+    {
+        for (int y = 0; y < 4; ++y) {
+            const int sy = std::min(by * 4 + y, level.height - 1);
+            for (int x = 0; x < 4; ++x) {
+                const int sx = std::min(bx * 4 + x, level.width - 1);
+                std::memcpy(&block[(y * 4 + x) * 4], &level.pixels[(static_cast<size_t>(sy) * level.width + sx) * 4], 4);
+            }
+        }
+    }
+
+    // principal axis of the block's first channels channels, returned as the
+    // two extreme points along it
+    void FitAxis(const unsigned char block[64], int channels, float lo[4], float hi[4])
+    {
+        float mean[4] = {};
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < channels; ++c) mean[c] += block[i * 4 + c];
+        }
+        for (int c = 0; c < channels; ++c) mean[c] /= 16.0f;
+
+        float cov[4][4] = {};
+        for (int i = 0; i < 16; ++i) {
+            float d[4];
+            for (int c = 0; c < channels; ++c) d[c] = block[i * 4 + c] - mean[c];
+            for (int r = 0; r < channels; ++r) {
+                for (int c = r; c < channels; ++c) cov[r][c] += d[r] * d[c];
+            }
+        }
+        for (int r = 0; r < channels; ++r) {
+            for (int c = 0; c < r; ++c) cov[r][c] = cov[c][r];
+        }
+
+        // a few power iterations are plenty for 16 points. they start from the
+        // channel that varies most, a fixed start such as the gray axis can be
+        // at right angles to the main axis (a red/green checker) and stay put
+        int widest = 0;
+        for (int c = 1; c < channels; ++c) {
+            if (cov[c][c] > cov[widest][widest]) widest = c;
+        }
+        float axis[4] = {};
+        axis[widest] = 1.0f;
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[4] = {};
+            float length = 0.0f;
+            for (int r = 0; r < channels; ++r) {
+                for (int c = 0; c < channels; ++c) next[r] += cov[r][c] * axis[c];
+                length = std::max(length, std::fabs(next[r]));
+            }
+            if (length < 1e-6f) break;
+            for (int c = 0; c < channels; ++c) axis[c] = next[c] / length;
+        }
+
+        float minT = 0.0f, maxT = 0.0f;
+        float norm = 0.0f;
+        for (int c = 0; c < channels; ++c) norm += axis[c] * axis[c];
+        for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (int c = 0; c < channels; ++c) t += (block[i * 4 + c] - mean[c]) * axis[c];
+            t /= norm;
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        for (int c = 0; c < channels; ++c) {
+            lo[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+            hi[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+        }
+    }
+
+    inline int Squared(int value) { return value * value; }
+
+    uint16_t To565(const float colour[3])
+    {
+        const int r = static_cast<int>(colour[0] * 31.0f / 255.0f + 0.5f);
+        const int g = static_cast<int>(colour[1] * 63.0f / 255.0f + 0.5f);
+        const int b = static_cast<int>(colour[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void From565(uint16_t packed, int colour[3])
+    {
+        const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        colour[0] = (r << 3) | (r >> 2);
+        colour[1] = (g << 2) | (g >> 4);
+        colour[2] = (b << 3) | (b >> 2);
+    }
+
+    inline void Put16(unsigned char* out, uint16_t value)
+    {
+        out[0] = static_cast<unsigned char>(value);
+        out[1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    // bc1 colour block, always in four-colour mode so bc3 can share it
+    void EncodeColourBlock(const unsigned char block[64], unsigned char out[8])
+    {
+        float lo[4], hi[4];
+        FitAxis(block, 3, lo, hi);
+        uint16_t c0 = To565(hi), c1 = To565(lo);
+        if (c0 < c1) std::swap(c0, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            int palette[4][3];
+            From565(c0, palette[0]);
+            From565(c1, palette[1]);
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+            for (int i = 0; i < 16; ++i) {
+                const unsigned char* texel = &block[i * 4];
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 4; ++p) {
+                    const int error = Squared(texel[0] - palette[p][0]) + Squared(texel[1] - palette[p][1])
+                        + Squared(texel[2] - palette[p][2]);
+                    if (error < bestError) {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= static_cast<uint32_t>(best) << (i * 2);
+            }
+        }
+
+        Put16(out, c0);
+        Put16(out + 2, c1);
+        Put16(out + 4, static_cast<uint16_t>(indices));
+        Put16(out + 6, static_cast<uint16_t>(indices >> 16));
+    }
+
+    // bc3 alpha block in eight-value mode
+    void EncodeAlphaBlock(const unsigned char block[64], unsigned char out[8])
+    {
+        int a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; ++i) {
+            a0 = std::max(a0, static_cast<int>(block[i * 4 + 3]));
+            a1 = std::min(a1, static_cast<int>(block[i * 4 + 3]));
+        }
+
+        uint64_t indices = 0;
+        if (a0 != a1) {
+            int palette[8] = { a0, a1 };
+            for (int p = 2; p < 8; ++p) palette[p] = ((8 - p) * a0 + (p - 1) * a1 + 3) / 7;
+            for (int i = 0; i < 16; ++i) {
+                const int alpha = block[i * 4 + 3];
+                int best = 0, bestError = 1 << 30;
+                for (int p = 0; p < 8; ++p) {
+                    const int error = Squared(alpha - palette[p]);
+                    if (error < bestError) {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= static_cast<uint64_t>(best) << (i * 3);
+            }
+        }
+
+        out[0] = static_cast<unsigned char>(a0);
+        out[1] = static_cast<unsigned char>(a1);
+        for (int b = 0; b < 6; ++b) out[2 + b] = static_cast<unsigned char>(indices >> (b * 8));
+    }
+
+    // bits written lsb first into a 128-bit block
+    class BlockWriter {
+    public:
+        explicit BlockWriter(unsigned char* out) : out(out) { std::memset(out, 0, 16); }
+
+        void Put(uint32_t value, int bits)
+        {
+            for (int b = 0; b < bits; ++b, ++position) {
+                if (value & (1u << b)) out[position >> 3] |= static_cast<unsigned char>(1u << (position & 7));
+            }
+        }
+
+    private:
+        unsigned char* out;
+        int position = 0;
+    };
+
+    const int kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // bc7 mode 6: tries all four p-bit pairs on the fitted endpoints
+    void EncodeBc7Block(const unsigned char block[64], unsigned char out[16])
+    {
+        float lo[4], hi[4];
+        FitAxis(block, 4, lo, hi);
+
+        int bestError = 1 << 30;
+        int bestEndpoints[2][4] = {};
+        int bestBits[2] = {};
+        int bestIndices[16] = {};
+        for (int bits = 0; bits < 4; ++bits) {
+            const int p[2] = { bits & 1, bits >> 1 };
+            int quantised[2][4], endpoints[2][4];
+            for (int c = 0; c < 4; ++c) {
+                const float source[2] = { lo[c], hi[c] };
+                for (int e = 0; e < 2; ++e) {
+                    quantised[e][c] = std::min(std::max(static_cast<int>((source[e] - p[e]) / 2.0f + 0.5f), 0), 127);
+                    endpoints[e][c] = (quantised[e][c] << 1) | p[e];
+                }
+            }
+
+            int palette[16][4];
+            for (int w = 0; w < 16; ++w) {
+                for (int c = 0; c < 4; ++c) {
+                    palette[w][c] = ((64 - kBc7Weights[w]) * endpoints[0][c] + kBc7Weights[w] * endpoints[1][c] + 32) >> 6;
+                }
+            }
+
+            int error = 0;
+            int indices[16];
+            for (int i = 0; i < 16 && error < bestError; ++i) {
+                const unsigned char* texel = &block[i * 4];
+                int best = 0, texelError = 1 << 30;
+                for (int w = 0; w < 16; ++w) {
+                    const int e = Squared(texel[0] - palette[w][0]) + Squared(texel[1] - palette[w][1])
+                        + Squared(texel[2] - palette[w][2]) + Squared(texel[3] - palette[w][3]);
+                    if (e < texelError) {
+                        texelError = e;
+                        best = w;
+                    }
+                }
+                indices[i] = best;
+                error += texelError;
+            }
+            if (error < bestError) {
+                bestError = error;
+                std::memcpy(bestEndpoints, quantised, sizeof(quantised));
+                bestBits[0] = p[0];
+                bestBits[1] = p[1];
+                std::memcpy(bestIndices, indices, sizeof(indices));
+            }
+        }
+
+        // the first texel's index drops its top bit, swap ends if it is set
+        if (bestIndices[0] & 8) {
+            for (int c = 0; c < 4; ++c) std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+            std::swap(bestBits[0], bestBits[1]);
+            for (int& index : bestIndices) index = 15 - index;
+        }
+
+        BlockWriter writer(out);
+        writer.Put(1u << 6, 7);
+        for (int c = 0; c < 4; ++c) {
+            writer.Put(bestEndpoints[0][c], 7);
+            writer.Put(bestEndpoints[1][c], 7);
+        }
+        writer.Put(bestBits[0], 1);
+        writer.Put(bestBits[1], 1);
+        writer.Put(bestIndices[0], 3);
+        for (int i = 1; i < 16; ++i) writer.Put(bestIndices[i], 4);
+    }
+
+    void EncodeBlock(const unsigned char block[64], TextureFormat format, unsigned char* out)
+    {
+        switch (format) {
+        case TextureFormat::BC1:
+            EncodeColourBlock(block, out);
+            break;
+        case TextureFormat::BC3:
+            EncodeAlphaBlock(block, out);
+            EncodeColourBlock(block, out + 8);
+            break;
+        case TextureFormat::BC7:
+            EncodeBc7Block(block, out);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+int BlockDimension(TextureFormat format)
+{
+    return format == TextureFormat::RGBA8 ? 1 : 4;
+}
+
+size_t BlockBytes(TextureFormat format)
+{
+    switch (format) {
+    case TextureFormat::BC1: return 8;
+    case TextureFormat::BC3:
+    case TextureFormat::BC7: return 16;
+    default: return 4;
+    }
+}
+
+size_t LevelRowBytes(TextureFormat format, int width)
+{
+    const int dim = BlockDimension(format);
+    return static_cast<size_t>((width + dim - 1) / dim) * BlockBytes(format);
+}
+
+int LevelRowCount(TextureFormat format, int height)
+{
+    const int dim = BlockDimension(format);
+    return (height + dim - 1) / dim;
+}
+
+size_t LevelSize(TextureFormat format, int width, int height)
+{
+    return LevelRowBytes(format, width) * LevelRowCount(format, height);
+}
+
+bool HasAlpha(const unsigned char* rgba, int width, int height)
+{
+    const size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count; ++i) {
+        if (rgba[i * 4 + 3] != 255) return true;
+    }
+    return false;
+}
+
+void BuildMipChain(const unsigned char* rgba, int width, int height, std::vector<MipLevel>& levels)
+{
+    levels.clear();
+    MipLevel base;
+    base.width = width;
+    base.height = height;
+    base.pixels.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    levels.push_back(std::move(base));
+    if (width <= 1 && height <= 1) return;
+
+    // the first step reads srgb texels, the rest stay in linear floats
+    LinearLevel linear = Downsample(width, height, [&](int x, int y, float* out) {
+        Expand(&rgba[(static_cast<size_t>(y) * width + x) * 4], out);
+    });
+    levels.push_back(ToSrgb8(linear));
+    while (linear.width > 1 || linear.height > 1) {
+        const LinearLevel& source = linear;
+        LinearLevel next = Downsample(source.width, source.height, [&](int x, int y, float* out) {
+            std::memcpy(out, &source.texels[(static_cast<size_t>(y) * source.width + x) * 4], sizeof(float) * 4);
+        });
+        linear = std::move(next);
+        levels.push_back(ToSrgb8(linear));
+    }
+}
+
+MipLevel EncodeLevel(const MipLevel& level, TextureFormat format, ThreadPool* pool)
+{
+    if (format == TextureFormat::RGBA8) return level;
+
+    MipLevel encoded;
+    encoded.width = level.width;
+    encoded.height = level.height;
+    encoded.pixels.resize(LevelSize(format, level.width, level.height));
+
+    const int blocksWide = (level.width + 3) / 4;
+    const int blocksHigh = (level.height + 3) / 4;
+    const size_t blockBytes = BlockBytes(format);
+    auto encodeRows = [&](int first, int last) {
+        unsigned char block[64];
+        for (int by = first; by < last; ++by) {
+            for (int bx = 0; bx < blocksWide; ++bx) {
+                FetchBlock(level, bx, by, block);
+                EncodeBlock(block, format, &encoded.pixels[(static_cast<size_t>(by) * blocksWide + bx) * blockBytes]);
+            }
+        }
+    };
+
+    if (!pool || blocksHigh <= kRowsPerTask) {
+        encodeRows(0, blocksHigh);
+        return encoded;
+    }
+    const size_t tasks = (blocksHigh + kRowsPerTask - 1) / kRowsPerTask;
+    pool->ParallelFor(tasks, [&](size_t task) {
+        const int first = static_cast<int>(task) * kRowsPerTask;
+        encodeRows(first, std::min(first + kRowsPerTask, blocksHigh));
+    });
+    return encoded;
+}
+
+TextureImage CookTexture(const unsigned char* rgba, int width, int height, TextureFormat format, ThreadPool* pool)
+{
+    TextureImage image;
+    image.format = format;
+    if (format == TextureFormat::BC1 && HasAlpha(rgba, width, height)) image.format = TextureFormat::BC3;
+
+    BuildMipChain(rgba, width, height, image.levels);
+    if (image.format != TextureFormat::RGBA8) {
+        for (MipLevel& level : image.levels) level = EncodeLevel(level, image.format, pool);
+    }
+    return image;
+}
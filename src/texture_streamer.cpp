@@ -0,0 +1,314 @@
+#include "../include/texture_streamer.h"
+#include "../include/cache_store.h"
+#include "../include/hash.h"
+#include "../include/log.h"
+#include "../include/profiler.h"
+#include "../include/stb_image.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+namespace {
+    // the placeholder is the first mip no larger than this on either side
+    constexpr int kPlaceholderSize = 64;
+
+    GLenum InternalFormat(TextureFormat format)
+    {
+        switch (format) {
+        case TextureFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case TextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TextureFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default: return GL_RGBA8;
+        }
+    }
+
+    bool HasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const GLubyte* extension = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+            if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0) return true;
+        }
+        return false;
+    }
+
+    // bc1 and bc3 come with s3tc, bc7 with bptc
+    bool Supported(TextureFormat format)
+    {
+        switch (format) {
+        case TextureFormat::BC1:
+        case TextureFormat::BC3: return HasExtension("GL_EXT_texture_compression_s3tc");
+        case TextureFormat::BC7: return HasExtension("GL_ARB_texture_compression_bptc");
+        default: return true;
+        }
+    }
+
+    // runs on the worker: the cooked chain from the cache, or decode and cook it
+    std::unique_ptr<DecodedTexture> Load(const std::string& path, TextureFormat format, bool useCache)
+    {
+        PROFILE_ZONE("load texture");
+        auto texture = std::make_unique<DecodedTexture>();
+        texture->path = path;
+
+        CacheStore& store = CacheStore::Default();
+        CacheEntry entry;
+        const uint64_t optionsKey = Hash64::Of(&format, sizeof(format));
+        const bool cached = useCache && store.Resolve(path, optionsKey, kTextureCookVersion, entry, CacheKind::Texture);
+        if (cached) {
+            TextureCache cache;
+            if (store.Open(entry, cache) == CacheStatus::Ok && cache.Read(texture->image)) {
+                texture->fromCache = true;
+                return texture;
+            }
+        }
+
+        int width = 0, height = 0, channels = 0;
+        unsigned char* data = nullptr;
+        {
+            PROFILE_ZONE("decode texture");
+            data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+        }
+        if (!data) return texture;
+
+        {
+            PROFILE_ZONE("cook texture");
+            ThreadPool encoders;
+            texture->image = CookTexture(data, width, height, format, &encoders);
+        }
+        stbi_image_free(data);
+
+        if (cached) {
+            PROFILE_ZONE("cache write");
+            store.Store(entry, texture->image);
+        }
+        return texture;
+    }
+
+    // level storage, data may be null to leave it undefined
+    void SetLevel(TextureFormat format, GLint index, const MipLevel& level, const void* data)
+    {
+        if (format == TextureFormat::RGBA8) {
+            glTexImage2D(GL_TEXTURE_2D, index, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            return;
+        }
+        glCompressedTexImage2D(GL_TEXTURE_2D, index, InternalFormat(format), level.width, level.height, 0,
+            static_cast<GLsizei>(level.pixels.size()), data);
+    }
+
+    void SetSampling(unsigned int texture, int levels)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+
+    void DeleteTexture(unsigned int& texture)
+    {
+        if (texture != 0) glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
+
+// one worker, cooking spreads its block encoding over a pool of its own
+TextureStreamer::TextureStreamer()
+    : pool(1)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    Release();
+}
+
+void TextureStreamer::Request(const std::vector<std::string>& paths)
+{
+    TextureFormat cook = format;
+    if (!paths.empty() && !Supported(cook)) {
+        LOG_WARNING("texture", "Compressed texture format not supported, using RGBA8");
+        cook = TextureFormat::RGBA8;
+    }
+
+    // abandoned loads still queued on the worker return at once, one that
+    // already started finishes and is simply dropped
+    if (abandoned) abandoned->store(true);
+    abandoned = std::make_shared<std::atomic<bool>>(false);
+    decoding.clear();
+    if (stream) DeleteTexture(stream->texture);
+    stream.reset();
+
+    for (size_t i = paths.size(); i < slots.size(); ++i) {
+        DeleteTexture(slots[i].texture);
+        DeleteTexture(slots[i].placeholder);
+    }
+    slots.resize(paths.size());
+    finished = 0;
+
+    const bool cache = useCache;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        const std::string path = paths[i];
+        std::shared_ptr<std::atomic<bool>> skip = abandoned;
+        decoding.push_back({ i, pool.Submit([path, cook, cache, skip]() {
+            return skip->load() ? std::unique_ptr<DecodedTexture>() : Load(path, cook, cache);
+        }) });
+    }
+}
+
+void TextureStreamer::Update()
+{
+    PROFILE_ZONE("gl upload texture");
+    // one texture streams at a time, in request order
+    if (!stream && !decoding.empty()
+        && decoding.front().image.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        const size_t slot = decoding.front().slot;
+        std::unique_ptr<DecodedTexture> image = decoding.front().image.get();
+        decoding.pop_front();
+        Begin(slot, std::move(image));
+    }
+    if (!stream) return;
+
+    const TextureFormat format = stream->image->image.format;
+    const int dim = BlockDimension(format);
+    const MipLevel* level = &stream->image->image.levels[stream->level];
+
+    // whole rows of blocks per batch, at least one so a tiny budget still progresses
+    size_t budget = frameBudget;
+    glBindTexture(GL_TEXTURE_2D, stream->texture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    while (stream) {
+        const size_t rowBytes = LevelRowBytes(format, level->width);
+        const int rowCount = LevelRowCount(format, level->height);
+        const int rows = static_cast<int>(std::min<size_t>(rowCount - stream->row, std::max<size_t>(1, budget / rowBytes)));
+        const size_t bytes = static_cast<size_t>(rows) * rowBytes;
+
+        // orphan the previous contents so the map never waits on the gpu
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!mapped) {
+            LOG_ERROR("texture", "Could not map texture upload buffer");
+            break;
+        }
+        std::memcpy(mapped, &level->pixels[static_cast<size_t>(stream->row) * rowBytes], bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // block rows cover 4 texel rows, the last one may be cut short
+        const GLint y = stream->row * dim;
+        const GLsizei height = std::min(rows * dim, level->height - y);
+        const GLint index = static_cast<GLint>(stream->level);
+        if (format == TextureFormat::RGBA8) {
+            glTexSubImage2D(GL_TEXTURE_2D, index, 0, y, level->width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        else {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, index, 0, y, level->width, height, InternalFormat(format),
+                static_cast<GLsizei>(bytes), nullptr);
+        }
+
+        stream->row += rows;
+        stream->bytesDone += bytes;
+        if (stream->row == rowCount) {
+            if (stream->level == 0) {
+                Finish();
+                break;
+            }
+            --stream->level;
+            stream->row = 0;
+            level = &stream->image->image.levels[stream->level];
+        }
+        if (bytes >= budget) break;
+        budget -= bytes;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::Begin(size_t slot, std::unique_ptr<DecodedTexture> image)
+{
+    if (image->image.levels.empty()) {
+        LOG_ERROR("texture", "Could not load texture: " << image->path);
+        ++finished;
+        return;
+    }
+
+    // the old texture belongs to the previous mesh, show the placeholder instead
+    unsigned int& placeholder = slots[slot].placeholder;
+    DeleteTexture(slots[slot].texture);
+    DeleteTexture(placeholder);
+    if (pbo == 0) glGenBuffers(1, &pbo);
+
+    const TextureFormat format = image->image.format;
+    const std::vector<MipLevel>& levels = image->image.levels;
+    size_t low = 0;
+    while (low + 1 < levels.size() && (levels[low].width > kPlaceholderSize || levels[low].height > kPlaceholderSize)) ++low;
+
+    glGenTextures(1, &placeholder);
+    SetSampling(placeholder, 1);
+    SetLevel(format, 0, levels[low], levels[low].pixels.data());
+
+    // allocate every level now, Update fills them in
+    stream = std::make_unique<Stream>();
+    stream->slot = slot;
+    glGenTextures(1, &stream->texture);
+    SetSampling(stream->texture, static_cast<int>(levels.size()));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        SetLevel(format, static_cast<GLint>(i), levels[i], nullptr);
+        stream->bytesTotal += levels[i].pixels.size();
+    }
+    stream->level = levels.size() - 1;
+    stream->image = std::move(image);
+}
+
+void TextureStreamer::Finish()
+{
+    LOG_INFO("texture", "Streamed texture" << (stream->image->fromCache ? " from cache: " : ": ") << stream->image->path
+        << " (" << stream->bytesTotal << " bytes)");
+    Slot& slot = slots[stream->slot];
+    slot.texture = stream->texture;
+    stream.reset();
+    DeleteTexture(slot.placeholder);
+    ++finished;
+}
+
+unsigned int TextureStreamer::Texture(size_t index) const
+{
+    if (index >= slots.size()) return 0;
+    return slots[index].texture != 0 ? slots[index].texture : slots[index].placeholder;
+}
+
+float TextureStreamer::Progress() const
+{
+    if (slots.empty()) return 0.0f;
+    double done = static_cast<double>(finished);
+    if (stream && stream->bytesTotal > 0) done += static_cast<double>(stream->bytesDone) / stream->bytesTotal;
+    return static_cast<float>(done / slots.size());
+}
+
+void TextureStreamer::Release()
+{
+    if (abandoned) abandoned->store(true);
+    decoding.clear();
+    if (stream) DeleteTexture(stream->texture);
+    stream.reset();
+    for (Slot& slot : slots) {
+        DeleteTexture(slot.texture);
+        DeleteTexture(slot.placeholder);
+    }
+    slots.clear();
+    finished = 0;
+    if (pbo != 0) glDeleteBuffers(1, &pbo);
+    pbo = 0;
+}
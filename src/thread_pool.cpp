@@ -0,0 +1,46 @@
+#include "../include/thread_pool.h"
+#include "../include/profiler.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    unsigned int count = ResolveThreadCount(threadCount);
+    workers.reserve(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+unsigned int ThreadPool::ResolveThreadCount(unsigned int requested)
+{
+    if (requested > 0) return requested;
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    Profiler::NameThread("pool worker");
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+            // finish queued work before shutting down
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,295 @@
+#include "../include/vertex_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    size_t AttributeAlignment(AttributeFormat format)
+    {
+        switch (format) {
+        case AttributeFormat::Float2:
+        case AttributeFormat::Float3:
+            return 4;
+        case AttributeFormat::Oct8:
+            return 1;
+        default:
+            return 2;
+        }
+    }
+
+    uint32_t Place(uint32_t& offset, AttributeFormat format)
+    {
+        const uint32_t alignment = static_cast<uint32_t>(AttributeAlignment(format));
+        offset = (offset + alignment - 1) / alignment * alignment;
+        const uint32_t at = offset;
+        offset += static_cast<uint32_t>(AttributeSize(format));
+        return at;
+    }
+
+    inline uint16_t ToUnorm16(float value, float offset, float scale)
+    {
+        if (scale == 0.0f) return 0;
+        const float unit = std::min(std::max((value - offset) / scale, 0.0f), 1.0f);
+        return static_cast<uint16_t>(unit * 65535.0f + 0.5f);
+    }
+
+    inline int ToSnorm(float value, int max)
+    {
+        const float clamped = std::min(std::max(value, -1.0f), 1.0f);
+        return static_cast<int>(std::lround(clamped * static_cast<float>(max)));
+    }
+
+    // unit vector onto the octahedron, unfolded into [-1, 1]^2
+    glm::vec2 OctEncode(const glm::vec3& n)
+    {
+        const float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+        if (sum == 0.0f) return glm::vec2(0.0f, 0.0f);
+        glm::vec2 e(n.x / sum, n.y / sum);
+        if (n.z < 0.0f) {
+            e = glm::vec2((1.0f - std::fabs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::fabs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f));
+        }
+        return e;
+    }
+
+    glm::vec3 OctDecode(glm::vec2 e)
+    {
+        glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+        const float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        const float length = glm::length(n);
+        return length > 0.0f ? n / length : n;
+    }
+
+    template <typename T>
+    void Store(unsigned char* at, T value)
+    {
+        std::memcpy(at, &value, sizeof(T));
+    }
+
+    template <typename T>
+    T Load(const unsigned char* at)
+    {
+        T value;
+        std::memcpy(&value, at, sizeof(T));
+        return value;
+    }
+}
+
+bool IsValidVertexFormat(const VertexFormat& format)
+{
+    const bool position = format.position == AttributeFormat::Float3 || format.position == AttributeFormat::Unorm16x3;
+    const bool uv = format.uv == AttributeFormat::Float2 || format.uv == AttributeFormat::Half2
+        || format.uv == AttributeFormat::Unorm16x2;
+    const bool normal = format.normal == AttributeFormat::Float3 || format.normal == AttributeFormat::Oct8
+        || format.normal == AttributeFormat::Oct16;
+    return position && uv && normal;
+}
+
+size_t AttributeSize(AttributeFormat format)
+{
+    switch (format) {
+    case AttributeFormat::Float2: return 8;
+    case AttributeFormat::Float3: return 12;
+    case AttributeFormat::Unorm16x3: return 6;
+    case AttributeFormat::Half2: return 4;
+    case AttributeFormat::Unorm16x2: return 4;
+    case AttributeFormat::Oct8: return 2;
+    case AttributeFormat::Oct16: return 4;
+    default: return 0;
+    }
+}
+
+VertexLayout MakeVertexLayout(const VertexFormat& format)
+{
+    VertexLayout layout;
+    layout.format = format;
+    uint32_t offset = 0;
+    layout.positionOffset = Place(offset, format.position);
+    layout.uvOffset = Place(offset, format.uv);
+    layout.normalOffset = Place(offset, format.normal);
+    layout.stride = (offset + 3) & ~3u;
+    return layout;
+}
+
+std::vector<unsigned char> QuantizeVertices(const Vertex* vertices, size_t count, VertexLayout& layout)
+{
+    layout = MakeVertexLayout(layout.format);
+    VertexQuantization& q = layout.quantization;
+
+    if (count > 0 && layout.format.position == AttributeFormat::Unorm16x3) {
+        glm::vec3 low = vertices[0].position, high = vertices[0].position;
+        for (size_t i = 1; i < count; ++i) {
+            low = glm::min(low, vertices[i].position);
+            high = glm::max(high, vertices[i].position);
+        }
+        q.positionOffset = low;
+        q.positionScale = high - low;
+    }
+    if (count > 0 && layout.format.uv == AttributeFormat::Unorm16x2) {
+        glm::vec2 low = vertices[0].uv, high = vertices[0].uv;
+        for (size_t i = 1; i < count; ++i) {
+            low = glm::min(low, vertices[i].uv);
+            high = glm::max(high, vertices[i].uv);
+        }
+        q.uvOffset = low;
+        q.uvScale = high - low;
+    }
+
+    std::vector<unsigned char> records(count * layout.stride, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex& vertex = vertices[i];
+        unsigned char* record = records.data() + i * layout.stride;
+
+        unsigned char* position = record + layout.positionOffset;
+        if (layout.format.position == AttributeFormat::Unorm16x3) {
+            for (int c = 0; c < 3; ++c) {
+                Store<uint16_t>(position + c * 2, ToUnorm16(vertex.position[c], q.positionOffset[c], q.positionScale[c]));
+            }
+        }
+        else {
+            std::memcpy(position, &vertex.position, sizeof(glm::vec3));
+        }
+
+        unsigned char* uv = record + layout.uvOffset;
+        switch (layout.format.uv) {
+        case AttributeFormat::Half2:
+            Store<uint16_t>(uv, FloatToHalf(vertex.uv.x));
+            Store<uint16_t>(uv + 2, FloatToHalf(vertex.uv.y));
+            break;
+        case AttributeFormat::Unorm16x2:
+            Store<uint16_t>(uv, ToUnorm16(vertex.uv.x, q.uvOffset.x, q.uvScale.x));
+            Store<uint16_t>(uv + 2, ToUnorm16(vertex.uv.y, q.uvOffset.y, q.uvScale.y));
+            break;
+        default:
+            std::memcpy(uv, &vertex.uv, sizeof(glm::vec2));
+            break;
+        }
+
+        unsigned char* normal = record + layout.normalOffset;
+        if (layout.format.normal == AttributeFormat::Float3) {
+            std::memcpy(normal, &vertex.normal, sizeof(glm::vec3));
+        }
+        else {
+            const glm::vec2 e = OctEncode(vertex.normal);
+            if (layout.format.normal == AttributeFormat::Oct8) {
+                Store<int8_t>(normal, static_cast<int8_t>(ToSnorm(e.x, 127)));
+                Store<int8_t>(normal + 1, static_cast<int8_t>(ToSnorm(e.y, 127)));
+            }
+            else {
+                Store<int16_t>(normal, static_cast<int16_t>(ToSnorm(e.x, 32767)));
+                Store<int16_t>(normal + 2, static_cast<int16_t>(ToSnorm(e.y, 32767)));
+            }
+        }
+    }
+    return records;
+}
+
+Vertex DequantizeVertex(const unsigned char* record, const VertexLayout& layout)
+{
+    const VertexQuantization& q = layout.quantization;
+    Vertex vertex;
+
+    const unsigned char* position = record + layout.positionOffset;
+    if (layout.format.position == AttributeFormat::Unorm16x3) {
+        for (int c = 0; c < 3; ++c) {
+            vertex.position[c] = q.positionOffset[c] + Load<uint16_t>(position + c * 2) / 65535.0f * q.positionScale[c];
+        }
+    }
+    else {
+        std::memcpy(&vertex.position, position, sizeof(glm::vec3));
+    }
+
+    const unsigned char* uv = record + layout.uvOffset;
+    switch (layout.format.uv) {
+    case AttributeFormat::Half2:
+        vertex.uv = glm::vec2(HalfToFloat(Load<uint16_t>(uv)), HalfToFloat(Load<uint16_t>(uv + 2)));
+        break;
+    case AttributeFormat::Unorm16x2:
+        vertex.uv = glm::vec2(q.uvOffset.x + Load<uint16_t>(uv) / 65535.0f * q.uvScale.x,
+            q.uvOffset.y + Load<uint16_t>(uv + 2) / 65535.0f * q.uvScale.y);
+        break;
+    default:
+        std::memcpy(&vertex.uv, uv, sizeof(glm::vec2));
+        break;
+    }
+
+    const unsigned char* normal = record + layout.normalOffset;
+    if (layout.format.normal == AttributeFormat::Oct8) {
+        vertex.normal = OctDecode(glm::vec2(std::max(Load<int8_t>(normal) / 127.0f, -1.0f),
+            std::max(Load<int8_t>(normal + 1) / 127.0f, -1.0f)));
+    }
+    else if (layout.format.normal == AttributeFormat::Oct16) {
+        vertex.normal = OctDecode(glm::vec2(std::max(Load<int16_t>(normal) / 32767.0f, -1.0f),
+            std::max(Load<int16_t>(normal + 2) / 32767.0f, -1.0f)));
+    }
+    else {
+        std::memcpy(&vertex.normal, normal, sizeof(glm::vec3));
+    }
+    return vertex;
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t magnitude = bits & 0x7fffffffu;
+
+    if (magnitude >= 0x7f800000u) {
+        // inf stays inf, nan stays a quiet nan
+        return static_cast<uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u));
+    }
+    if (magnitude >= 0x477ff000u) {
+        // rounds past the largest half
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    if (magnitude < 0x38800000u) {
+        // half subnormal or zero: align the implicit bit, then round to nearest even
+        if (magnitude < 0x33000000u) return sign;
+        const uint32_t exponent = magnitude >> 23;
+        const uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+        const uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u))) ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // normal: rebias the exponent and round the mantissa to 10 bits
+    uint32_t half = ((magnitude - 0x38000000u) >> 13);
+    const uint32_t rest = magnitude & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) ++half;
+    return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(uint16_t value)
+{
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0x1fu) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0) {
+        bits = sign;
+    }
+    else {
+        // subnormal half, normalise it
+        uint32_t e = 113;
+        while ((mantissa & 0x400u) == 0) {
+            mantissa <<= 1;
+            --e;
+        }
+        bits = sign | (e << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}